@@ -0,0 +1,172 @@
+#include "arena.h"
+#include <stdlib.h>
+
+#define ARENA_MIN_SIZE 4096
+#define ARENA_MAX_SIZE 1048576 // chunks stop growing here
+#define ARENA_ALIGN (2 * sizeof(void *))
+
+struct arena_chunk {
+  struct arena_chunk *next;
+  size_t size; // bytes of data
+  size_t used;
+};
+
+// the data follows the header, aligned
+#define ARENA_HEADER \
+  ((sizeof(struct arena_chunk) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define ARENA_DATA(chunk) ((char *)(chunk) + ARENA_HEADER)
+
+struct arena_chunk *arena_chunk_new(size_t size)
+{
+  struct arena_chunk *chunk = malloc(ARENA_HEADER + size);
+
+  if (!chunk)
+    return NULL;
+
+  chunk->next = NULL;
+  chunk->size = size;
+  chunk->used = 0;
+
+  return chunk;
+}
+
+struct arena *arena_new(size_t size)
+{
+  struct arena *arena = malloc(sizeof(struct arena));
+
+  if (!arena)
+    return NULL;
+
+  if (size < ARENA_MIN_SIZE)
+    size = ARENA_MIN_SIZE;
+
+  arena->chunks = arena_chunk_new(size);
+  if (!arena->chunks) {
+    free(arena);
+    return NULL;
+  }
+  arena->chunkSize = size;
+  arena->used = 0;
+
+  return arena;
+}
+
+void arena_free(struct arena *arena)
+{
+  struct arena_chunk *chunk;
+
+  if (!arena)
+    return;
+
+  while ((chunk = arena->chunks)) {
+    arena->chunks = chunk->next;
+    free(chunk);
+  }
+  free(arena);
+}
+
+// returns size bytes aligned to align (a power of 2)
+void *arena_take(struct arena *arena, size_t size, size_t align)
+{
+  struct arena_chunk *chunk = arena->chunks;
+  size_t start = (chunk->used + align - 1) & ~(align - 1);
+
+  if (start > chunk->size || chunk->size - start < size) {
+    // big allocations get a chunk of their own behind the current one
+    if (size > arena->chunkSize / 4) {
+      if (!(chunk = arena_chunk_new(size)))
+        return NULL;
+      chunk->next = arena->chunks->next;
+      arena->chunks->next = chunk;
+    } else {
+      if (arena->chunkSize < ARENA_MAX_SIZE)
+        arena->chunkSize *= 2;
+      if (!(chunk = arena_chunk_new(arena->chunkSize)))
+        return NULL;
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+    }
+    start = 0;
+  }
+
+  chunk->used = start + size;
+  arena->used += size;
+
+  return ARENA_DATA(chunk) + start;
+}
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+  return arena_take(arena, size, ARENA_ALIGN);
+}
+
+void *arena_zalloc(struct arena *arena, size_t size)
+{
+  void *data = arena_take(arena, size, ARENA_ALIGN);
+
+  if (data)
+    memset(data, 0, size);
+
+  return data;
+}
+
+void *arena_realloc(struct arena *arena, void *ptr, size_t oldSize, 
+                    size_t size)
+{
+  struct arena_chunk *chunk = arena->chunks, **link;
+  void *data;
+
+  if (!ptr)
+    return arena_alloc(arena, size);
+  if (size <= oldSize)
+    return ptr;
+
+  // the last allocation of the current chunk grows into its free space
+  if ((char *)ptr + oldSize == ARENA_DATA(chunk) + chunk->used &&
+      size - oldSize <= chunk->size - chunk->used) {
+    chunk->used += size - oldSize;
+    arena->used += size - oldSize;
+    return ptr;
+  }
+
+  // an allocation with a chunk of its own grows with the chunk
+  for (link = &arena->chunks->next; *link; link = &(*link)->next) {
+    chunk = *link;
+    if (ARENA_DATA(chunk) != ptr || chunk->used != oldSize)
+      continue;
+
+    if (!(chunk = realloc(chunk, ARENA_HEADER + size)))
+      return NULL;
+    chunk->size = chunk->used = size;
+    *link = chunk;
+    arena->used += size - oldSize;
+    return ARENA_DATA(chunk);
+  }
+
+  if (!(data = arena_alloc(arena, size)))
+    return NULL;
+  memcpy(data, ptr, oldSize);
+
+  return data;
+}
+
+char *arena_strndup(struct arena *arena, const char *str, size_t len)
+{
+  char *copy = arena_take(arena, len + 1, 1);
+
+  if (!copy)
+    return NULL;
+
+  memcpy(copy, str, len);
+  copy[len] = 0;
+
+  return copy;
+}
+
+char *arena_strdup(struct arena *arena, const char *str)
+{
+  if (!str)
+    return NULL;
+
+  return arena_strndup(arena, str, strlen(str));
+}
@@ -0,0 +1,49 @@
+#ifndef ARENA_H
+#define ARENA_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+
+struct arena_chunk;
+
+// A bump allocator. Allocations can't be freed one by one, they are all
+// released together by arena_free.
+struct arena {
+  struct arena_chunk *chunks; // the chunk in use first
+  size_t chunkSize; // size of the next chunk
+  size_t used; // bytes handed out
+};
+
+// Allocates an arena whose first chunk holds about size bytes (a default 
+// when 0), returns NULL on failure
+struct arena *arena_new(size_t size);
+
+// Frees the arena and everything allocated from it
+void arena_free(struct arena *arena);
+
+// Returns size bytes aligned for any type or NULL on failure
+void *arena_alloc(struct arena *arena, size_t size);
+
+// Like arena_alloc but the memory is zeroed
+void *arena_zalloc(struct arena *arena, size_t size);
+
+// Grows an allocation of oldSize bytes to size bytes, in place when it is
+// the last one of its chunk. Returns the (maybe moved) data or NULL on
+// failure, when ptr stays as it was. A NULL ptr is a new allocation.
+void *arena_realloc(struct arena *arena, void *ptr, size_t oldSize, 
+                    size_t size);
+
+// Copies a string (NULL gives NULL), returns NULL on failure
+char *arena_strdup(struct arena *arena, const char *str);
+
+// Copies len bytes of str and terminates them, returns NULL on failure
+char *arena_strndup(struct arena *arena, const char *str, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ARENA_H
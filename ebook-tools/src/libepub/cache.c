@@ -0,0 +1,171 @@
+#include "epublib.h"
+
+// Unlinks blob from the LRU list
+void _ocf_cache_unlink(struct ocf_cache *cache, struct ocf_blob *blob) {
+  if (blob->prev)
+    blob->prev->next = blob->next;
+  else
+    cache->head = blob->next;
+
+  if (blob->next)
+    blob->next->prev = blob->prev;
+  else
+    cache->tail = blob->prev;
+
+  blob->prev = blob->next = NULL;
+}
+
+// Drops the cache reference of blob
+void _ocf_cache_drop(struct ocf_cache *cache, struct ocf_blob *blob) {
+  _ocf_cache_unlink(cache, blob);
+  cache->entries[blob->index] = NULL;
+  cache->used -= blob->size;
+  _ocf_blob_release(blob);
+}
+
+// Evicts least recently used entries until the cache fits in its budget
+void _ocf_cache_trim(struct ocf_cache *cache) {
+  while (cache->tail && cache->used > cache->budget) {
+    _ocf_cache_drop(cache, cache->tail);
+    cache->evictions++;
+  }
+}
+
+void _ocf_cache_set_budget(struct ocf *ocf, size_t budget) {
+  ocf->cache.budget = budget;
+  _ocf_cache_trim(&ocf->cache);
+}
+
+void _ocf_cache_close(struct ocf *ocf) {
+  struct ocf_cache *cache = &ocf->cache;
+
+  while (cache->head)
+    _ocf_cache_drop(cache, cache->head);
+
+  if (cache->entries)
+    free(cache->entries);
+  cache->entries = NULL;
+}
+
+// Returns the decompressed entry at index holding a reference for the
+// caller, which must be released with _ocf_blob_release. The entry is 
+// kept in the cache as long as it fits in the budget.
+struct ocf_blob *_ocf_blob_get(struct ocf *ocf, zip_int64_t index) {
+  struct ocf_cache *cache = &ocf->cache;
+  struct ocf_blob *blob;
+  char *data;
+  int size;
+
+  if (index < 0)
+    return NULL;
+
+  if (cache->entries && index < cache->count && 
+      (blob = cache->entries[index])) {
+    cache->hits++;
+    if (blob != cache->head) {
+      _ocf_cache_unlink(cache, blob);
+      blob->next = cache->head;
+      cache->head->prev = blob;
+      cache->head = blob;
+    }
+    blob->refs++;
+    return blob;
+  }
+
+  cache->misses++;
+
+  if ((size = _ocf_get_file_index(ocf, index, &data)) == -1)
+    return NULL;
+
+  if (! (blob = _ocf_blob_new(index, data, size))) {
+    _epub_err_set_oom(&ocf->epub->error);
+    return NULL;
+  }
+
+  return _ocf_cache_insert(ocf, blob);
+}
+
+// Hands a fresh blob over to the cache if it fits. Returns blob.
+struct ocf_blob *_ocf_cache_insert(struct ocf *ocf, struct ocf_blob *blob) {
+  struct ocf_cache *cache = &ocf->cache;
+  zip_int64_t index = blob->index;
+
+  if (! cache->budget || (size_t)blob->size > cache->budget)
+    return blob;
+
+  if (! cache->entries) {
+    cache->count = zip_get_num_entries(ocf->arch, ZIP_FL_UNCHANGED);
+    cache->entries = malloc(cache->count * sizeof(struct ocf_blob *));
+    if (! cache->entries)
+      return blob;
+    memset(cache->entries, 0, cache->count * sizeof(struct ocf_blob *));
+  }
+
+  if (index >= cache->count || cache->entries[index])
+    return blob;
+
+  blob->refs++;
+  blob->next = cache->head;
+  if (cache->head)
+    cache->head->prev = blob;
+  else
+    cache->tail = blob;
+  cache->head = blob;
+  cache->entries[index] = blob;
+  cache->used += blob->size;
+  _ocf_cache_trim(cache);
+
+  return blob;
+}
+
+// Wraps data (taking ownership) in a blob with one reference. On failure
+// data is freed and NULL returned.
+struct ocf_blob *_ocf_blob_new(zip_int64_t index, char *data, int size) {
+  struct ocf_blob *blob;
+
+  if (size == -1 || ! (blob = malloc(sizeof(struct ocf_blob)))) {
+    free(data);
+    return NULL;
+  }
+  memset(blob, 0, sizeof(struct ocf_blob));
+  blob->index = index;
+  blob->data = data;
+  blob->size = size;
+  blob->refs = 1;
+
+  return blob;
+}
+
+void _ocf_blob_release(struct ocf_blob *blob) {
+  if (! blob || --blob->refs > 0)
+    return;
+
+  free(blob->data);
+  free(blob);
+}
+
+// Like _ocf_get_file_index but goes through the cache
+int _ocf_get_cached_index(struct ocf *ocf, zip_int64_t index, char **fileStr) {
+  struct ocf_blob *blob;
+  int size;
+
+  *fileStr = NULL;
+
+  if (! ocf->cache.budget)
+    return _ocf_get_file_index(ocf, index, fileStr);
+
+  if (! (blob = _ocf_blob_get(ocf, index)))
+    return -1;
+
+  *fileStr = malloc(blob->size + 1);
+  if (! *fileStr) {
+    _epub_err_set_oom(&ocf->epub->error);
+    _ocf_blob_release(blob);
+    return -1;
+  }
+  memcpy(*fileStr, blob->data, blob->size + 1);
+  size = blob->size;
+  _ocf_blob_release(blob);
+
+  return size;
+}
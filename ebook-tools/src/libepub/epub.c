@@ -5,27 +5,109 @@
 const char _epub_error_oom[] = "out of memory";
 
 struct epub *epub_open(const char *filename, int debug) {
-  char *opfName = NULL;
-  char *opfStr = NULL;
-  char *pathsep_index = NULL;
+  return epub_open_ex(filename, 0, debug);
+}
 
+struct epub *epub_open_ex(const char *filename, int flags, int debug) {
+  struct epub *epub = _epub_new(flags, debug);
+  if (! epub) {
+    return NULL;
+  }
+  _epub_print_debug(epub, DEBUG_INFO, "opening '%s'", filename);
+  
+  if (! (epub->ocf = _ocf_parse(epub, filename))) {
+    epub_close(epub);
+    return NULL;
+  }
+
+  return _epub_parse(epub);
+}
+
+struct epub *epub_open_memory(const void *buf, size_t size, int flags, 
+                              int debug) {
+  struct epub *epub = _epub_new(flags, debug);
+  if (! epub) {
+    if (flags & EPUB_OPEN_OWN_BUFFER)
+      free((void *)buf);
+    return NULL;
+  }
+  _epub_print_debug(epub, DEBUG_INFO, "opening %lu bytes buffer", 
+                    (unsigned long)size);
+  
+  if (! (epub->ocf = _ocf_parse_memory(epub, buf, size, 
+                                       flags & EPUB_OPEN_OWN_BUFFER))) {
+    epub_close(epub);
+    return NULL;
+  }
+
+  return _epub_parse(epub);
+}
+
+struct epub *epub_open_fd(int fd, int flags, int debug) {
+  struct epub *epub = _epub_new(flags, debug);
+  if (! epub) {
+    return NULL;
+  }
+  _epub_print_debug(epub, DEBUG_INFO, "opening fd %d", fd);
+  
+  if (! (epub->ocf = _ocf_parse_fd(epub, fd))) {
+    epub_close(epub);
+    return NULL;
+  }
+
+  return _epub_parse(epub);
+}
+
+struct epub *_epub_new(int flags, int debug) {
   struct epub *epub = malloc(sizeof(struct epub));
   if (! epub) {
     return NULL;
   }
   epub->ocf = NULL;
   epub->opf = NULL;
+  if (_epub_new_pools(epub) == -1) {
+    free(epub);
+    return NULL;
+  }
   _epub_err_set_str(&epub->error, "", 0);
   epub->debug = debug;
-  _epub_print_debug(epub, DEBUG_INFO, "opening '%s'", filename);
+  epub->flags = flags;
   
   LIBXML_TEST_VERSION;
-  
-  if (! (epub->ocf = _ocf_parse(epub, filename))) {
-    epub_close(epub);
-    return NULL;
+
+  return epub;
+}
+
+// Allocates the arena, strings and interned table of epub. Returns -1 on
+// failure, when none is left allocated
+int _epub_new_pools(struct epub *epub) {
+  epub->arena = arena_new(0);
+  epub->strings = strpool_new();
+  epub->interned = hash_new((HashKeyFunc)_list_key_string, NULL, 64);
+  if (! epub->arena || ! epub->strings || ! epub->interned) {
+    _epub_free_pools(epub);
+    return -1;
   }
 
+  return 0;
+}
+
+void _epub_free_pools(struct epub *epub) {
+  arena_free(epub->arena);
+  strpool_free(epub->strings);
+  hash_free(epub->interned);
+  epub->arena = NULL;
+  epub->strings = NULL;
+  epub->interned = NULL;
+}
+
+// Parses the opf of the book once the ocf is open. Closes epub on 
+// failure
+struct epub *_epub_parse(struct epub *epub) {
+  char *opfName = NULL;
+  char *opfStr = NULL;
+  char *pathsep_index = NULL;
+
   opfName = _ocf_root_fullpath_by_type(epub->ocf, 
                                              "application/oebps-package+xml");
   if (!opfName) {
@@ -33,7 +115,14 @@ struct epub *epub_open(const char *filename, int debug) {
     return NULL;
   }
 
-  epub->ocf->datapath = malloc(sizeof(char) *(strlen(opfName) +1));
+  epub->ocf->datapath = arena_alloc(epub->arena, 
+                                    sizeof(char) *(strlen(opfName) +1));
+  if (!epub->ocf->datapath) {
+    _epub_err_set_oom(&epub->error);
+    free(opfName);
+    epub_close(epub);
+    return NULL;
+  }
   pathsep_index = strrchr(opfName, '/'); // '/' is per OCF specs
   if (pathsep_index) {
     strncpy(epub->ocf->datapath, opfName, pathsep_index + 1 - opfName); 
@@ -67,7 +156,7 @@ struct epub *epub_open(const char *filename, int debug) {
 }
 
 xmlChar *_getXmlStr(void *str) {
-  return xmlStrdup((xmlChar *)str); 
+  return xmlStrdup(*(xmlChar **)str); 
 }
 
 xmlChar *_getIdStr(void *id) {
@@ -114,10 +203,18 @@ xmlChar *_getRoleStr(void *creator) {
   return xmlStrdup(buff);
 }
 
+// Points the locals of epub_get_metadata at a category
+#define METADATA_ITEMS(v, func) \
+  (items = (char *)(v).items, count = (v).count, \
+   itemSize = sizeof(*(v).items), getStr = (func))
+
 xmlChar **epub_get_metadata(struct epub *epub, enum epub_metadata type, 
                             int *size) {
+  struct metadata *meta;
   xmlChar **data = NULL;
-  listPtr list = NULL;
+  char *items = NULL; // of the category
+  size_t itemSize = 0;
+  int count = 0;
   xmlChar *(*getStr)(void *) = NULL;
   int i;
 
@@ -126,145 +223,159 @@ xmlChar **epub_get_metadata(struct epub *epub, enum epub_metadata type,
     return NULL;
   }
 
+  meta = epub->opf->metadata;
   switch(type) {
   case EPUB_ID:
-    list = epub->opf->metadata->id;
-    getStr = _getIdStr;
+    METADATA_ITEMS(meta->id, _getIdStr);
     break;
   case EPUB_TITLE:
-    list = epub->opf->metadata->title;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->title, _getXmlStr);
     break;
   case EPUB_SUBJECT:
-    list = epub->opf->metadata->subject;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->subject, _getXmlStr);
     break;
   case EPUB_PUBLISHER:
-    list = epub->opf->metadata->publisher;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->publisher, _getXmlStr);
     break;
   case EPUB_DESCRIPTION:
-    list = epub->opf->metadata->description;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->description, _getXmlStr);
     break;
   case EPUB_DATE:
-    list = epub->opf->metadata->date;
-    getStr = _getDateStr;
+    METADATA_ITEMS(meta->date, _getDateStr);
     break;
   case EPUB_TYPE:
-    list = epub->opf->metadata->type;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->type, _getXmlStr);
     break;
   case EPUB_FORMAT:
-    list = epub->opf->metadata->format;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->format, _getXmlStr);
     break;
   case EPUB_SOURCE:
-    list = epub->opf->metadata->source;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->source, _getXmlStr);
     break;
   case EPUB_LANG:
-    list = epub->opf->metadata->lang;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->lang, _getXmlStr);
     break;
   case EPUB_RELATION:
-    list = epub->opf->metadata->relation;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->relation, _getXmlStr);
     break;
   case EPUB_COVERAGE:
-    list = epub->opf->metadata->coverage;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->coverage, _getXmlStr);
     break;
   case EPUB_RIGHTS:
-    list = epub->opf->metadata->rights;
-    getStr = _getXmlStr;
+    METADATA_ITEMS(meta->rights, _getXmlStr);
     break;
   case EPUB_CREATOR:
-    list = epub->opf->metadata->creator;
-    getStr = _getRoleStr;
+    METADATA_ITEMS(meta->creator, _getRoleStr);
     break;
   case EPUB_CONTRIB:
-    list = epub->opf->metadata->contrib;
-    getStr = _getRoleStr;
+    METADATA_ITEMS(meta->contrib, _getRoleStr);
     break;
   case EPUB_META:
-    list = epub->opf->metadata->meta;
-    getStr = _getMetaStr;
+    METADATA_ITEMS(meta->meta, _getMetaStr);
     break;
   default:
     _epub_print_debug(epub, DEBUG_INFO, "fetching metadata: unknown type %d", type);
     return NULL;
   }
 
-  if (list->Size <= 0)
+  if (count <= 0)
     return NULL;
 
-  data = malloc(list->Size * sizeof(xmlChar *));
+  data = malloc(count * sizeof(xmlChar *));
   if (! data) {
     _epub_err_set_oom(&epub->error);
     return NULL;
   }
   if (size) {
-    *size = list->Size;
+    *size = count;
   }
-  list->Current = list->Head;
 
-  data[0] = getStr(GetNode(list));
-  for (i=1;i<list->Size;i++) {
-    data[i] = getStr(NextNode(list));
+  for (i=0;i<count;i++) {
+    data[i] = getStr(items + i * itemSize);
   }
 
   return data;
 }
 
-// returns the next node that the iterator should return
-// if init also check if the current node is good
-// if linear is 0 return non linear else return linear
-listnodePtr _get_spine_it_next(listnodePtr curr, int linear, int init) {
-  struct spine *node; 
-
-  if (! curr)
+// returns the spine item at pos in the iterator's order or NULL
+struct spine *_get_spine_it_item(struct eiterator *it, int pos) {
+  if (pos < 0 || pos >= it->order->count)
     return NULL;
-  
-  if ( ! init) {
-    curr = curr->Next;
-  }
-
-  node = (struct spine *)GetNodeData(curr);
-  
-  while(curr) {
-    if (! node)
-      return NULL;
-    
-    node = (struct spine *)GetNodeData(curr);
-    
-    if (node->linear == linear)
-      return curr;
-    
-    curr = curr->Next;
-  }
 
-  return NULL;
+  return &it->epub->opf->spine->items[it->order->positions[pos]];
 }
 
-char *_get_spine_it_url(struct eiterator *it) {
-  struct manifest *tmp;
-  void *data;
+struct manifest *_get_spine_it_manifest(struct eiterator *it) {
+  struct spine *item;
 
   if (!it) 
 	  return NULL;
   
-  data = GetNodeData(it->curr);
-  tmp = _opf_manifest_get_by_id(it->epub->opf, 
-                                ((struct spine *)data)->idref);
-  if (!tmp) {
+  if (! (item = _get_spine_it_item(it, it->pos)))
+    return NULL;
+
+  if (!item->item) {
 	  _epub_print_debug(it->epub, DEBUG_ERROR, 
 						"spine parsing error idref %s is not in the manifest",
-						((struct spine *)data)->idref);
+						item->idref);
 	  return NULL;
   }
 
-  return (char *)tmp->href;
+  return item->item;
+}
+
+// Queues the items following the current one for prefetching
+void _get_spine_it_prefetch(struct eiterator *it) {
+  zip_int64_t indexes[EITERATOR_PREFETCH(~0)];
+  struct ocf_cache *cache = &it->epub->ocf->cache;
+  struct spine *node;
+  struct manifest *item;
+  int i, count = 0;
+
+  for (i = 1; i <= it->prefetch->count; i++) {
+    if (! (node = _get_spine_it_item(it, it->pos + i)))
+      break;
+
+    item = node->item;
+    if (! item || item->index < 0)
+      continue;
+
+    // already inflated
+    if (cache->entries && item->index < cache->count && 
+        cache->entries[item->index])
+      continue;
+
+    indexes[count++] = item->index;
+  }
+
+  _epub_prefetch_schedule(it->prefetch, indexes, count);
+}
+
+// Moves the iterator to pos in its order and returns the data there
+char *_get_spine_it_move(struct eiterator *it, int pos) {
+  if (it->cache) {
+    _ocf_blob_release(it->cache);
+    it->cache = NULL;
+  }
+
+  if (pos < -1)
+    pos = -1;
+  if (pos > it->order->count)
+    pos = it->order->count;
+  it->pos = pos;
+
+  if (it->prefetch) {
+    epub_it_get_curr(it);
+    _get_spine_it_prefetch(it);
+  }
+  
+  return epub_it_get_curr(it);
+}
+
+char *_get_spine_it_url(struct eiterator *it) {
+  struct manifest *tmp = _get_spine_it_manifest(it);
+
+  return tmp ? (char *)_epub_str(it->epub, tmp->href) : NULL;
 }
 
 struct eiterator *epub_get_iterator(struct epub *epub, 
@@ -272,7 +383,8 @@ struct eiterator *epub_get_iterator(struct epub *epub,
 
   struct eiterator *it = NULL;
 
-  if (!epub) {
+  if (!epub || !epub->opf->spine || 
+      type < 0 || type >= EITERATOR_TYPES) {
     return NULL;
   }
 
@@ -285,19 +397,18 @@ struct eiterator *epub_get_iterator(struct epub *epub,
   it->epub = epub;
   it->opt = opt;
   it->cache = NULL;
+  it->prefetch = NULL;
 
-  switch (type) {
-  case EITERATOR_SPINE:
-    it->curr = epub->opf->spine->Head;
-    break;
-  case EITERATOR_NONLINEAR:
-    it->curr = _get_spine_it_next(epub->opf->spine->Head, 0, 1); 
-    break;
-  case EITERATOR_LINEAR:
-    it->curr = _get_spine_it_next(epub->opf->spine->Head, 1, 1); 
-    break;
-  }
+  // Spine items are mostly stored in reading order
+  if (epub->ocf->seqReaders++ == 0)
+    _ocf_advise(epub->ocf, OCF_ACCESS_SEQUENTIAL);
+
+  it->order = &epub->opf->spineOrders[type];
+  it->pos = 0;
 
+  if (EITERATOR_PREFETCH(opt) && 
+      (it->prefetch = _epub_prefetch_start(it, EITERATOR_PREFETCH(opt))))
+    _get_spine_it_prefetch(it);
 
   return it;
 }
@@ -307,8 +418,11 @@ void epub_free_iterator(struct eiterator *it) {
     return;
   }
 
-  if (it->cache)
-    free(it->cache);
+  _epub_prefetch_stop(it->prefetch);
+  _ocf_blob_release(it->cache);
+
+  if (--it->epub->ocf->seqReaders == 0)
+    _ocf_advise(it->epub->ocf, OCF_ACCESS_RANDOM);
 
   free(it);
 }
@@ -330,8 +444,9 @@ char *epub_it_get_curr_url(struct eiterator *it) {
 }
 
 char *epub_it_get_curr(struct eiterator *it) {
+  struct manifest *item;
 
-  if (!it || !it->curr)
+  if (!it || !_get_spine_it_item(it, it->pos))
     return NULL;
 
   if (!it->cache) {
@@ -340,42 +455,105 @@ char *epub_it_get_curr(struct eiterator *it) {
     case EITERATOR_SPINE:
     case EITERATOR_NONLINEAR:
     case EITERATOR_LINEAR:
-      _ocf_get_data_file(it->epub->ocf, _get_spine_it_url(it), &(it->cache));
+      if (! (item = _get_spine_it_manifest(it)))
+        break;
+      if (it->prefetch && 
+          (it->cache = _epub_prefetch_take(it->prefetch, item->index)))
+        it->cache = _ocf_cache_insert(it->epub->ocf, it->cache);
+      else
+        it->cache = _ocf_blob_get(it->epub->ocf, item->index);
       break;
     }
   }
   
-  return it->cache;
+  return it->cache ? it->cache->data : NULL;
+}
+
+void epub_it_get_prefetch_stats(struct eiterator *it,
+                                struct epub_prefetch_stats *stats) {
+  memset(stats, 0, sizeof(struct epub_prefetch_stats));
+
+  if (it && it->prefetch) {
+#ifndef _WIN32
+    pthread_mutex_lock(&it->prefetch->lock);
+    *stats = it->prefetch->stats;
+    pthread_mutex_unlock(&it->prefetch->lock);
+#endif
+  }
 }
+
 char *epub_it_get_next(struct eiterator *it) {
   if (!it) {
     return NULL;
   }
 
-  if (it->cache) {
-    free(it->cache);
-    it->cache = NULL;
+  // stays past the last item
+  if (it->pos >= it->order->count)
+    return NULL;
+
+  return _get_spine_it_move(it, it->pos + 1);
+}
+
+char *epub_it_get_prev(struct eiterator *it) {
+  if (!it) {
+    return NULL;
   }
 
-  if (!it->curr)
+  // stays before the first item
+  if (it->pos < 0)
     return NULL;
 
-  switch (it->type) {
+  return _get_spine_it_move(it, it->pos - 1);
+}
 
-  case EITERATOR_SPINE:
-    it->curr = it->curr->Next;
-    break;
-    
-  case EITERATOR_NONLINEAR:
-    it->curr = _get_spine_it_next(it->curr, 0, 0); 
-    break;
+char *epub_it_seek(struct eiterator *it, int index) {
+  struct spine *items;
 
-  case EITERATOR_LINEAR:
-    it->curr = _get_spine_it_next(it->curr, 1, 0); 
-    break;
+  if (!it) {
+    return NULL;
   }
-  
-  return epub_it_get_curr(it);
+
+  items = it->epub->opf->spine->items;
+  if (index < 0 || index >= it->epub->opf->spine->count)
+    return _get_spine_it_move(it, index < 0 ? -1 : it->order->count);
+
+  return _get_spine_it_move(it, items[index].orderPos[it->type]);
+}
+
+int epub_it_get_index(struct eiterator *it) {
+  if (!it || !_get_spine_it_item(it, it->pos)) {
+    return -1;
+  }
+
+  return it->order->positions[it->pos];
+}
+
+int epub_spine_count(struct epub *epub) {
+  if (!epub || !epub->opf->spine) {
+    return -1;
+  }
+
+  return epub->opf->spine->count;
+}
+
+int epub_spine_get(struct epub *epub, int index, 
+                   struct epub_spine_item *item) {
+  struct spine *tmp;
+
+  if (!epub || !item || !epub->opf->spine || 
+      index < 0 || index >= epub->opf->spine->count) {
+    return -1;
+  }
+
+  tmp = &epub->opf->spine->items[index];
+  item->idref = (const char *)tmp->idref;
+  item->href = tmp->item ? 
+    (const char *)_epub_str(epub, tmp->item->href) : NULL;
+  item->media_type = tmp->item ? 
+    (const char *)_epub_str(epub, tmp->item->type) : NULL;
+  item->linear = tmp->linear;
+
+  return 0;
 }
 
 int epub_close(struct epub *epub) {
@@ -389,8 +567,8 @@ int epub_close(struct epub *epub) {
   if (epub->opf)
     _opf_close(epub->opf);
 
-  if (epub)
-    free(epub);
+  _epub_free_pools(epub);
+  free(epub);
 
   
   return 1;
@@ -404,6 +582,83 @@ void epub_set_debug(struct epub *epub, int debug) {
   epub->debug = debug;
 }
 
+// Returns a copy in the book's strings of the named attribute of the 
+// reader's element or NULL
+xmlChar *_epub_xml_attribute(struct epub *epub, xmlTextReaderPtr reader,
+                             const char *name) {
+  xmlChar *value = NULL;
+
+  // the value is read in place instead of through a libxml copy
+  if (xmlTextReaderMoveToAttribute(reader, (xmlChar *)name) == 1) {
+    value = (xmlChar *)strpool_strdup(epub->strings, 
+                                      (char *)xmlTextReaderConstValue(reader));
+    xmlTextReaderMoveToElement(reader);
+  }
+
+  return value;
+}
+
+// Returns a copy in the book's strings of the text of the reader's 
+// element or NULL
+xmlChar *_epub_xml_string(struct epub *epub, xmlTextReaderPtr reader) {
+  xmlChar *string = xmlTextReaderReadString(reader);
+  xmlChar *copy = (xmlChar *)strpool_strdup(epub->strings, (char *)string);
+
+  if (string)
+    xmlFree(string);
+
+  return copy;
+}
+
+// Like _epub_xml_attribute but returns the offset of the value in the
+// book's strings (0 if missing)
+uint32_t _epub_xml_attribute_offset(struct epub *epub, xmlTextReaderPtr reader,
+                                    const char *name) {
+  return strpool_offset(epub->strings, 
+                        (char *)_epub_xml_attribute(epub, reader, name));
+}
+
+// Returns the string at offset in the book's strings or NULL
+xmlChar *_epub_str(struct epub *epub, uint32_t offset) {
+  return (xmlChar *)strpool_get(epub->strings, offset);
+}
+
+// Returns the copy of str in the book's strings shared by all its
+// interned occurrences (NULL for NULL or on failure), so they compare by
+// address. It must not be modified.
+xmlChar *_epub_intern(struct epub *epub, const xmlChar *str) {
+  char *copy;
+
+  if (! str)
+    return NULL;
+
+  if ((copy = hash_get(epub->interned, (const char *)str)))
+    return (xmlChar *)copy;
+
+  if (! (copy = strpool_strdup(epub->strings, (const char *)str)) ||
+      hash_add(epub->interned, copy) == -1) {
+    _epub_err_set_oom(&epub->error);
+    return NULL;
+  }
+
+  return (xmlChar *)copy;
+}
+
+// Returns the named attribute of the reader's element interned or NULL.
+// For values repeated all over a book, see _epub_intern
+xmlChar *_epub_xml_attribute_interned(struct epub *epub, 
+                                      xmlTextReaderPtr reader, 
+                                      const char *name) {
+  xmlChar *value = NULL;
+
+  if (xmlTextReaderMoveToAttribute(reader, (xmlChar *)name) == 1) {
+    value = _epub_intern(epub, xmlTextReaderConstValue(reader));
+    xmlTextReaderMoveToElement(reader);
+  }
+
+  return value;
+}
+
 void _epub_print_debug(struct epub *epub, int debug, const char *format, ...) {
   va_list ap;
   char strerr[1025];
@@ -418,48 +673,62 @@ void _epub_print_debug(struct epub *epub, int debug, const char *format, ...) {
   }
 
   if (! epub || (epub->debug >= debug)) {
-    fprintf(stderr, "libepub ");
+    const char *level = "";
+
     switch(debug) {
     case DEBUG_ERROR: 
-      
-      fprintf(stderr, "(EE)");
-    break;
+      level = "(EE)";
+      break;
     case DEBUG_WARNING:
-      fprintf(stderr, "(WW)");
+      level = "(WW)";
       break;
     case DEBUG_INFO:
-      fprintf(stderr, "(II)");
+      level = "(II)";
       break;
     case DEBUG_VERBOSE:
-      fprintf(stderr, "(VV)");
+      level = "(VV)";
       break;
     }
-    fprintf(stderr, ": \t%s\n" , strerr);
+    // in one piece, lines of the toc worker may come at the same time
+    fprintf(stderr, "libepub %s: \t%s\n", level, strerr);
   }
   va_end(ap);
 }
 
+// Returns the category a toc iterator goes through
+struct tocCategory *_get_tit_category(struct titerator *tit) {
+  return tit->type == TITERATOR_PAGES ? 
+    tit->epub->opf->toc->pageList : tit->epub->opf->toc->navMap;
+}
+
 int epub_tit_next(struct titerator *tit) {
-  listnodePtr curr = NULL;
+  struct opf *opf;
+  struct tocCategory *tc = NULL;
+  int count;
 
   if (!tit) {
     return 0;
   }
 
-  curr = tit->next;
-  if (! curr) {
+  opf = tit->epub->opf;
+  if (tit->type == TITERATOR_GUIDE) {
+    count = opf->guide->count;
+  } else {
+    tc = _get_tit_category(tit);
+    count = tc->items.count;
+  }
+
+  if (tit->next >= count) {
     tit->valid = 0;
     return 0;
   }
-
-  tit->next = curr->Next;
   
   switch (tit->type) {
     struct guide* guide;
     struct tocItem *ti;
 
   case TITERATOR_GUIDE:
-    guide = GetNodeData(curr);
+    guide = &opf->guide->items[tit->next];
     tit->cache.label = (char *)guide->title;
     tit->cache.link = (char *)guide->href;
     tit->cache.depth = 1;
@@ -468,19 +737,16 @@ int epub_tit_next(struct titerator *tit) {
 
   case TITERATOR_NAVMAP:
   case TITERATOR_PAGES:
-    ti = GetNodeData(curr);
-    tit->cache.label = 
-      (char *)_opf_label_get_by_doc_lang(tit->epub->opf, ti->label);
-
-    if (! tit->cache.label)
-      tit->cache.label = (char *)ti->id;
-
+    ti = &tc->items.items[tit->next];
+    // resolved with the toc, see _opf_resolve_toc_labels
+    tit->cache.label = (char *)ti->text;
     tit->cache.depth = ti->depth;
-    tit->cache.link = (char *)ti->src;
+    tit->cache.link = (char *)_epub_str(tit->epub, ti->src);
     break;
 
   }
 
+  tit->next++;
   tit->valid = 1;
   return 1;
 }
@@ -488,11 +754,15 @@ int epub_tit_next(struct titerator *tit) {
 struct titerator *epub_get_titerator(struct epub *epub, 
                                      enum titerator_type type, int opt) {
   struct titerator *it = NULL;
+  struct tocCategory *tc;
 
   if (!epub) {
     return NULL;
   }
 
+  if (type == TITERATOR_NAVMAP || type == TITERATOR_PAGES)
+    _opf_load_toc(epub->opf);
+
   switch (type) {
   case TITERATOR_NAVMAP:
     if (! epub->opf->toc || ! epub->opf->toc->navMap)
@@ -516,7 +786,7 @@ struct titerator *epub_get_titerator(struct epub *epub,
   it->type = type;
   it->epub = epub;
   it->opt = opt;
-  it->next = NULL;
+  it->next = 0;
   it->valid = 0;
 
   it->cache.label = NULL;
@@ -524,31 +794,17 @@ struct titerator *epub_get_titerator(struct epub *epub,
   it->cache.depth = -1;
 
 
+  // the label of the category comes first
   switch (type) {
   case TITERATOR_NAVMAP:
-    it->next = epub->opf->toc->navMap->items->Head;
-    if (epub->opf->toc->navMap->label) {
-      it->cache.label = 
-        (char *)_opf_label_get_by_doc_lang(epub->opf, 
-                                           epub->opf->toc->navMap->label);
-      it->cache.depth = 0;
-    }
+  case TITERATOR_PAGES:
+    tc = _get_tit_category(it);
+    it->cache.label = (char *)tc->text;
+    it->cache.depth = type == TITERATOR_NAVMAP ? 0 : 1;
     it->valid = 1;
     break;
 
   case TITERATOR_GUIDE:
-    it->next = epub->opf->guide->Head;
-    break;
-    
-  case TITERATOR_PAGES:
-    it->next = epub->opf->toc->pageList->items->Head;
-    if (epub->opf->toc->pageList->label) {
-      it->cache.label = 
-        (char *)_opf_label_get_by_doc_lang(epub->opf, 
-                                           epub->opf->toc->pageList->label);
-      it->cache.depth = 1;
-    }
-    it->valid = 1;
     break;
   }
   
@@ -575,6 +831,41 @@ char *epub_tit_get_curr_label(struct titerator *tit) {
   return tit->cache.label?strdup(tit->cache.label):NULL;
 }
 
+const char *epub_tit_curr_label(struct titerator *tit) {
+  return tit ? tit->cache.label : NULL;
+}
+
+const char *epub_tit_curr_link(struct titerator *tit) {
+  return tit ? tit->cache.link : NULL;
+}
+
+int epub_set_toc_langs(struct epub *epub, const char **langs, int count) {
+  struct opf *opf;
+  xmlChar *lang;
+  int i;
+
+  if (! epub || ! epub->opf)
+    return -1;
+
+  opf = epub->opf;
+  opf->labelLangs.count = 0;
+  for (i = 0; i < count; i++) {
+    if (! langs[i])
+      continue;
+
+    // interned like the languages of the labels, so they compare alike
+    if (! (lang = _epub_intern(epub, (const xmlChar *)langs[i])) ||
+        VECTOR_ADD(epub, opf->labelLangs, lang) == -1)
+      return -1;
+  }
+
+  // a toc parsed already is labelled again, later ones are labelled
+  // as they are parsed
+  _opf_resolve_toc_labels(opf);
+
+  return 0;
+}
+
 int epub_tit_get_curr_depth(struct titerator *tit) {
   if (!tit) {
     return 0;
@@ -605,19 +896,234 @@ void epub_free_titerator(struct titerator *tit) {
 }
   
 int epub_get_ocf_file(struct epub *epub, const char *filename, char **data) {
+  zip_int64_t index;
+
   if (!epub) {
     return -1;
   }
 
-  return _ocf_get_file(epub->ocf, filename, data);
+  *data = NULL;
+
+  if ((index = _ocf_check_file(epub->ocf, filename)) == -1) {
+    _epub_print_debug(epub, DEBUG_INFO, "%s - %s", 
+                      filename, zip_strerror(epub->ocf->arch));
+    return -1;
+  }
+
+  return _ocf_get_cached_index(epub->ocf, index, data);
 }
 
 int epub_get_data(struct epub *epub, const char *name, char **data) {
+  char *canon_name;
+  int size;
+
+  if (!epub) {
+    return -1;
+  }
+
+  if (! (canon_name = _ocf_data_name(epub->ocf, name))) {
+    *data = NULL;
+    return -1;
+  }
+
+  size = epub_get_ocf_file(epub, canon_name, data);
+  free(canon_name);
+
+  return size;
+}
+
+int epub_get_data_range(struct epub *epub, const char *name, size_t offset,
+                        int len, char *buf) {
+  char *canon_name;
+  zip_int64_t index;
+
+  if (!epub || !buf) {
+    return -1;
+  }
+
+  if (! (canon_name = _ocf_data_name(epub->ocf, name))) {
+    return -1;
+  }
+
+  if ((index = _ocf_check_file(epub->ocf, canon_name)) == -1) {
+    _epub_print_debug(epub, DEBUG_INFO, "%s - %s", 
+                      canon_name, zip_strerror(epub->ocf->arch));
+    free(canon_name);
+    return -1;
+  }
+  free(canon_name);
+
+  return _ocf_get_range(epub->ocf, index, offset, buf, len);
+}
+
+int epub_manifest_by_href(struct epub *epub, const char *href,
+                          struct epub_manifest_item *item) {
+  struct manifest *tmp;
+
+  if (!epub || !href || !item) {
+    return -1;
+  }
+
+  if (! (tmp = _opf_manifest_get_by_href(epub->opf, href))) {
+    return -1;
+  }
+
+  item->id = (const char *)_epub_str(epub, tmp->id);
+  item->href = (const char *)_epub_str(epub, tmp->href);
+  item->media_type = (const char *)_epub_str(epub, tmp->type);
+  item->spine_index = tmp->spineIndex;
+
+  return 0;
+}
+
+int epub_spine_index_of_href(struct epub *epub, const char *href) {
+  struct manifest *tmp;
+
+  if (!epub || !href) {
+    return -1;
+  }
+
+  tmp = _opf_manifest_get_by_href(epub->opf, href);
+
+  return tmp ? tmp->spineIndex : -1;
+}
+
+int epub_extract_all(struct epub *epub, const char *dest_dir, int nthreads) {
+  if (!epub || !dest_dir || !dest_dir[0]) {
+    return -1;
+  }
+
+  return _epub_extract_all(epub, dest_dir, nthreads);
+}
+
+void epub_set_cache_size(struct epub *epub, size_t bytes) {
+  if (!epub) {
+    return;
+  }
+
+  _ocf_cache_set_budget(epub->ocf, bytes);
+}
+
+void epub_get_cache_stats(struct epub *epub, struct epub_cache_stats *stats) {
+  if (!epub || !stats) {
+    return;
+  }
+
+  stats->hits = epub->ocf->cache.hits;
+  stats->misses = epub->ocf->cache.misses;
+  stats->evictions = epub->ocf->cache.evictions;
+  stats->bytes = epub->ocf->cache.used;
+  stats->budget = epub->ocf->cache.budget;
+}
+
+int epub_get_data_view(struct epub *epub, const char *name, 
+                       struct epub_view *view) {
+  char *canon_name;
+  int size;
+
+  if (!epub || !view) {
+    return -1;
+  }
+
+  if (! (canon_name = _ocf_data_name(epub->ocf, name))) {
+    view->data = NULL;
+    view->size = 0;
+    view->owned = NULL;
+    return -1;
+  }
+
+  size = _ocf_get_view(epub->ocf, canon_name, view);
+  free(canon_name);
+
+  return size;
+}
+
+int epub_get_ocf_view(struct epub *epub, const char *filename, 
+                      struct epub_view *view) {
+  if (!epub || !view) {
+    return -1;
+  }
+
+  return _ocf_get_view(epub->ocf, filename, view);
+}
+
+void epub_free_view(struct epub_view *view) {
+  if (!view) {
+    return;
+  }
+
+  _ocf_blob_release(view->owned);
+
+  view->data = NULL;
+  view->size = 0;
+  view->owned = NULL;
+}
+
+struct estream *epub_stream_open(struct epub *epub, const char *name) {
+  struct estream *stream;
+  char *canon_name;
+
   if (!epub) {
+    return NULL;
+  }
+
+  if (! (canon_name = _ocf_data_name(epub->ocf, name))) {
+    return NULL;
+  }
+
+  stream = malloc(sizeof(struct estream));
+  if (!stream) {
+    _epub_err_set_oom(&epub->error);
+    free(canon_name);
+    return NULL;
+  }
+  stream->epub = epub;
+  stream->pos = 0;
+  stream->file = _ocf_open_file(epub->ocf, canon_name, &stream->size);
+  free(canon_name);
+
+  if (!stream->file) {
+    free(stream);
+    return NULL;
+  }
+
+  return stream;
+}
+
+int epub_stream_read(struct estream *stream, char *buf, int len) {
+  zip_int64_t size;
+  int total = 0;
+
+  if (!stream || !buf || len < 0) {
     return -1;
   }
 
-  return _ocf_get_data_file(epub->ocf, name, data);
+  while (total < len && stream->pos < stream->size) {
+    size = zip_fread(stream->file, buf + total, len - total);
+    if (size == -1) {
+      _epub_print_debug(stream->epub, DEBUG_INFO, "stream read - %s", 
+                        zip_file_strerror(stream->file));
+      return -1;
+    }
+    if (size == 0)
+      break;
+
+    total += size;
+    stream->pos += size;
+  }
+
+  return total;
+}
+
+void epub_stream_close(struct estream *stream) {
+  if (!stream) {
+    return;
+  }
+
+  if (zip_fclose(stream->file) != 0)
+    _epub_print_debug(stream->epub, DEBUG_INFO, "failed closing stream");
+
+  free(stream);
 }
 
 void epub_dump(struct epub *epub) {
@@ -9,6 +9,9 @@ struct epub;
 struct eiterator;
 struct titerator;
 
+/** \struct estream is a private struct for reading a file in chunks */
+struct estream;
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* C++ */
@@ -23,6 +26,47 @@ extern "C" {
       
   */
   EPUB_EXPORT struct epub *epub_open(const char *filename, int debug);
+
+  /** 
+      Like epub_open but accepts open flags. With EPUB_OPEN_MMAP the 
+      archive is mapped into memory once and all entries are read from 
+      the mapping, which saves a read syscall and a copy per entry.
+      
+      @param filename the name of the file to open
+      @param flags a bitwise or of epub_open_flags
+      @param debug is the debug level (0=none, 1=errors, 2=warnings, 3=info)
+      @return epub struct with the information of the file or NULL on error
+  */
+  EPUB_EXPORT struct epub *epub_open_ex(const char *filename, int flags, 
+                                        int debug);
+
+  /** 
+      Like epub_open_ex for a book held in memory. The buffer is read in 
+      place and must stay valid until epub_close, unless 
+      EPUB_OPEN_OWN_BUFFER is set: the buffer (which must come from 
+      malloc) then belongs to the epub and is freed on close, or right 
+      away if the book can't be opened.
+      
+      @param buf the book bytes
+      @param size the size of buf
+      @param flags a bitwise or of epub_open_flags
+      @param debug is the debug level (0=none, 1=errors, 2=warnings, 3=info)
+      @return epub struct with the information of the file or NULL on error
+  */
+  EPUB_EXPORT struct epub *epub_open_memory(const void *buf, size_t size,
+                                            int flags, int debug);
+
+  /** 
+      Like epub_open_ex for an open file descriptor. Regular files are 
+      mapped, other descriptors (pipes, sockets) are read to the end. 
+      The descriptor isn't kept and may be closed once the call returns.
+      
+      @param fd the file descriptor
+      @param flags a bitwise or of epub_open_flags
+      @param debug is the debug level (0=none, 1=errors, 2=warnings, 3=info)
+      @return epub struct with the information of the file or NULL on error
+  */
+  EPUB_EXPORT struct epub *epub_open_fd(int fd, int flags, int debug);
   
   /**
      This function sets the debug level to the given level.
@@ -88,14 +132,180 @@ extern "C" {
   */
   EPUB_EXPORT int epub_get_data(struct epub *epub, const char *name, char **data);
 
+  /** 
+      Returns a view of the file with the given name in the data 
+      directory. Entries stored uncompressed in an archive opened with
+      EPUB_OPEN_MMAP are borrowed straight from the mapping (and are not
+      null terminated), other entries are read into a buffer owned by
+      the view. Either way the view must be released with epub_free_view
+      and must not outlive the epub.
+
+      @param epub struct of the epub file we want to read from
+      @param name the name of the file we want to read
+      @param view where the view is stored
+      @return the number of bytes in the view or -1 on error
+  */
+  EPUB_EXPORT int epub_get_data_view(struct epub *epub, const char *name, 
+                                     struct epub_view *view);
+
+  /** 
+      Like epub_get_data_view but the filename is relative to the 
+      archive root (see epub_get_ocf_file).
+
+      @param epub struct of the epub file we want to read from
+      @param filename the name of the file we want to read
+      @param view where the view is stored
+      @return the number of bytes in the view or -1 on error
+  */
+  EPUB_EXPORT int epub_get_ocf_view(struct epub *epub, const char *filename, 
+                                    struct epub_view *view);
+
+  /** 
+      Releases a view returned by epub_get_data_view or epub_get_ocf_view
+      
+      @param view the view
+  */
+  EPUB_EXPORT void epub_free_view(struct epub_view *view);
+
   
+  /** 
+      Opens the file with the given name in the data directory for 
+      reading in chunks. Unlike epub_get_data the file is never held in
+      memory as a whole, which is what you want for big media files.
+
+      @param epub struct of the epub file we want to read from
+      @param name the name of the file we want to read
+      @return the stream or NULL on error
+  */
+  EPUB_EXPORT struct estream *epub_stream_open(struct epub *epub, 
+                                               const char *name);
+
+  /** 
+      Reads the next chunk of the stream into buf. The buffer is filled 
+      completely unless the end of the file is reached.
+
+      @param stream the stream
+      @param buf where the data is stored
+      @param len the size of buf
+      @return the number of bytes read, 0 at the end of the file and -1 
+      on error
+  */
+  EPUB_EXPORT int epub_stream_read(struct estream *stream, char *buf, int len);
+
+  /** 
+      Closes the stream and frees the memory held by it
+      
+      @param stream the stream
+  */
+  EPUB_EXPORT void epub_stream_close(struct estream *stream);
+
+  /** 
+      Reads len bytes starting at offset of the file with the given name
+      in the data directory. Stored files are read at the offset, 
+      deflated ones keep checkpoints of the inflater as they are read, 
+      so later reads anywhere in the file only inflate from the closest
+      checkpoint (about 1MB apart) instead of from the start.
+
+      @param epub struct of the epub file
+      @param name the name of the file
+      @param offset where to start reading
+      @param len the number of bytes to read
+      @param buf where the data is stored, at least len bytes
+      @return the number of bytes read (less than len at the end of the
+      file, 0 past it) or -1 on error
+  */
+  EPUB_EXPORT int epub_get_data_range(struct epub *epub, const char *name,
+                                      size_t offset, int len, char *buf);
+
+  /** 
+      Finds the manifest item of an href, such as a table of contents 
+      link, relative to the data directory. The #fragment is ignored and
+      %XX escapes are decoded before comparing.
+
+      @param epub struct of the epub file
+      @param href the href
+      @param item filled with the item
+      @return 0 if the item was found, -1 otherwise
+  */
+  EPUB_EXPORT int epub_manifest_by_href(struct epub *epub, const char *href,
+                                        struct epub_manifest_item *item);
+
+  /** 
+      Returns the position in the spine of the file an href points to.
+      The href is matched like in epub_manifest_by_href.
+
+      @param epub struct of the epub file
+      @param href the href
+      @return the 0 based position among all the spine items or -1 if 
+      the file isn't in the spine
+  */
+  EPUB_EXPORT int epub_spine_index_of_href(struct epub *epub, 
+                                           const char *href);
+
+  /** 
+      Extracts every file of the archive under dest_dir, creating the 
+      directories as needed. The entries are spread over nthreads 
+      workers, each reading through its own archive handle. A failing 
+      entry doesn't stop the others, the failures are reported as 
+      warnings.
+
+      @param epub struct of the epub file
+      @param dest_dir the destination directory
+      @param nthreads number of worker threads
+      @return the number of entries that couldn't be extracted or -1 if 
+      the destination couldn't be created
+  */
+  EPUB_EXPORT int epub_extract_all(struct epub *epub, const char *dest_dir,
+                                   int nthreads);
+
+  /** 
+      Sets the byte budget of the cache of decompressed entries. The 
+      cache is shared by epub_get_data, epub_get_ocf_file, the views and
+      the book iterators, so files read over and over (css, fonts, 
+      images) are inflated only once. Least recently used entries are 
+      evicted when the budget is exceeded. The cache is disabled (0) by
+      default.
+
+      @param epub struct of the epub file
+      @param bytes the budget in bytes, 0 disables the cache
+  */
+  EPUB_EXPORT void epub_set_cache_size(struct epub *epub, size_t bytes);
+
+  /** 
+      Returns the cache counters
+
+      @param epub struct of the epub file
+      @param stats where the counters are stored
+  */
+  EPUB_EXPORT void epub_get_cache_stats(struct epub *epub, 
+                                        struct epub_cache_stats *stats);
+
+  /** 
+      Returns the number of items in the spine, linear or not.
+      
+      @param epub struct of the epub file
+      @return the number of items or -1 if the spine wasn't parsed
+  */
+  EPUB_EXPORT int epub_spine_count(struct epub *epub);
+
+  /** 
+      Returns an item of the spine.
+      
+      @param epub struct of the epub file
+      @param index 0 based position in the spine
+      @param item filled with the item
+      @return 0 on success, -1 if index is out of the spine
+  */
+  EPUB_EXPORT int epub_spine_get(struct epub *epub, int index,
+                                 struct epub_spine_item *item);
+
   /** 
       Returns a book iterator of the requested type
       for the given epub struct.
       
       @param epub struct of the epub file
       @param type the iterator type
-      @param opt other options (ignored for now)
+      @param opt other options, EITERATOR_PREFETCH(n) reads n items ahead
       @return eiterator to the epub book
   */
   EPUB_EXPORT struct eiterator *epub_get_iterator(struct epub *epub, 
@@ -110,6 +320,35 @@ extern "C" {
   */
   EPUB_EXPORT char *epub_it_get_next(struct eiterator *it);
 
+  /**
+     updates the iterator to the previous element and returns a pointer 
+     to the data. the iterator handles the freeing of the memory.
+     
+     @param it the iterator
+     @return pointer to the data
+  */
+  EPUB_EXPORT char *epub_it_get_prev(struct eiterator *it);
+
+  /**
+     Moves the iterator to the spine item at index, or to the first item 
+     after it that the iterator goes through, and returns a pointer to 
+     the data. the iterator handles the freeing of the memory.
+     
+     @param it the iterator
+     @param index 0 based position in the spine (see epub_spine_count)
+     @return pointer to the data or NULL if there's no such item
+  */
+  EPUB_EXPORT char *epub_it_seek(struct eiterator *it, int index);
+
+  /**
+     Returns the spine position of the iterator's current data.
+     
+     @param it the iterator
+     @return 0 based position in the spine or -1 if there is no 
+     current data
+  */
+  EPUB_EXPORT int epub_it_get_index(struct eiterator *it);
+
   /**
      Returns a pointer to the iterator's data. the iterator handles 
      the freeing of the memory.
@@ -128,6 +367,17 @@ extern "C" {
   */
   EPUB_EXPORT char *epub_it_get_curr_url(struct eiterator *it);
 
+  /**
+     Returns the prefetch counters of an iterator opened with 
+     EITERATOR_PREFETCH. All the counters are 0 if the iterator 
+     doesn't prefetch.
+     
+     @param it the iterator
+     @param stats filled with the counters
+  */
+  EPUB_EXPORT void epub_it_get_prefetch_stats(struct eiterator *it,
+                                              struct epub_prefetch_stats *stats);
+
   /** 
       Returns a book toc iterator of the requested type
       for the given epub struct.
@@ -176,6 +426,42 @@ extern "C" {
   */
   EPUB_EXPORT char *epub_tit_get_curr_label(struct titerator *tit);
 
+  /**
+     Like epub_tit_get_curr_link but returns the link itself instead of
+     a copy. It must not be freed and stays valid until epub_close.
+
+     @param tit the iterator
+     @return the current entry's link or NULL
+  */
+  EPUB_EXPORT const char *epub_tit_curr_link(struct titerator *tit);
+
+  /**
+     Like epub_tit_get_curr_label but returns the label itself instead of
+     a copy. It must not be freed and stays valid until epub_close. The
+     labels are picked once, when the toc is parsed, so going through a
+     toc this way allocates nothing.
+
+     @param tit the iterator
+     @return the current entry's label or NULL
+  */
+  EPUB_EXPORT const char *epub_tit_curr_label(struct titerator *tit);
+
+  /**
+     Sets the languages the labels of toc entries are preferred in, most
+     wanted first. An entry is labelled by its first label in one of 
+     these languages, or else in the language of the book (labels 
+     without a language match any). The labels of a toc parsed already
+     are picked again, so set the languages before going through the 
+     toc.
+
+     @param epub struct of the epub file
+     @param langs language codes (like "en" or "fr-CA"), copied
+     @param count the number of languages, 0 for the book's only
+     @return 0 on success, -1 on failure
+  */
+  EPUB_EXPORT int epub_set_toc_langs(struct epub *epub, const char **langs,
+                                     int count);
+
   /** 
       Frees the memory held by the given iterator
       
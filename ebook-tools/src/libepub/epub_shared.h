@@ -1,6 +1,8 @@
 #ifndef EPUB_SHARED_H
 #define EPUB_SHARED_H 1
 
+#include <stddef.h>
+
 #ifdef _WIN32
 # ifdef epub_EXPORTS
 #  define EPUB_EXPORT __declspec(dllexport)
@@ -33,6 +35,22 @@ enum epub_metadata {
   EPUB_META /**< ebook extra metadata*/ 
 };
 
+/**
+   Flags for epub_open_ex
+*/
+enum epub_open_flags {
+  EPUB_OPEN_MMAP = 1, /**< map the archive into memory instead of reading it */
+  EPUB_OPEN_OWN_BUFFER = 2, /**< epub_open_memory frees the buffer on close */
+  EPUB_OPEN_METADATA_ONLY = 4, /**< read the metadata only, no spine, 
+                                 manifest, guide or table of contents */
+  EPUB_OPEN_SAX = 8, /**< parse the package and table of contents with
+                        SAX2 callbacks, taking all the attributes of an
+                        element at once, instead of the text reader */
+  EPUB_OPEN_TOC = 16 /**< parse the table of contents while opening, on a
+                        worker thread running alongside the rest of the
+                        package, instead of on first use */
+};
+
 /**
    Ebook Iterator types
 */
@@ -43,6 +61,12 @@ enum eiterator_type {
   /*  EITERATOR_TOUR */
 };
 
+/**
+   Iterator option to inflate the next n (up to 255) spine items on a
+   background thread while the current one is being read
+*/
+#define EITERATOR_PREFETCH(n) ((n) & 0xff)
+
 /**
    Ebook Table Of Content Iterator types
 */
@@ -62,4 +86,56 @@ enum page_spread_position {
   PAGE_SPREAD_UNKNOWN
 };
 
+/**
+   A manifest item, see epub_manifest_by_href. The strings belong to
+   the epub.
+*/
+struct epub_manifest_item {
+  const char *id; /**< the item id */
+  const char *href; /**< href relative to the data directory (decoded) */
+  const char *media_type; /**< mime type */
+  int spine_index; /**< first position in the spine or -1 */
+};
+
+/**
+   An item of the spine, see epub_spine_get. The strings belong to the
+   epub.
+*/
+struct epub_spine_item {
+  const char *idref; /**< id of the manifest item */
+  const char *href; /**< href of the manifest item or NULL if missing */
+  const char *media_type; /**< mime type or NULL if missing */
+  int linear; /**< 0 for non linear items */
+};
+
+/**
+   A view of an archive entry, see epub_get_data_view
+*/
+struct epub_view {
+  const char *data; /**< the entry bytes */
+  int size; /**< number of bytes in data */
+  void *owned; /**< private, buffer released by epub_free_view */
+};
+
+/**
+   Counters of the decompressed entry cache, see epub_set_cache_size
+*/
+struct epub_cache_stats {
+  unsigned long hits; /**< reads served from the cache */
+  unsigned long misses; /**< reads that had to inflate the entry */
+  unsigned long evictions; /**< entries dropped to stay in budget */
+  size_t bytes; /**< bytes currently cached */
+  size_t budget; /**< the cache budget in bytes */
+};
+
+/**
+   Prefetch counters of an iterator, see epub_it_get_prefetch_stats
+*/
+struct epub_prefetch_stats {
+  unsigned long ready; /**< items that were inflated in time */
+  unsigned long waited; /**< items the reader had to wait for */
+  unsigned long missed; /**< items read without prefetching, or whose
+                           prefetching failed */
+};
+
 #endif
@@ -9,11 +9,18 @@
 #include <zip.h>
 #include <zlib.h>
 
+#ifndef _WIN32
+# include <pthread.h>
+#endif
+
 // For parsing xml
 #include <libxml/xmlreader.h>
 
 // For list stuff
 #include "linklist.h"
+#include "hash.h"
+#include "arena.h"
+#include "strpool.h"
 #include "epub_shared.h"
 
 // General definitions
@@ -46,6 +53,22 @@
 #define ENCRYPTION_FILENAME "encryption.xml"
 #define RIGHTS_FILENAME "rights.xml"
 
+// A growable array of type in the arena of the epub, empty when zeroed
+#define VECTOR(type) struct { type *items; int count; int alloc; }
+
+// Appends a zeroed item to the VECTOR v. Evaluates to the item or to NULL
+// when out of memory
+#define VECTOR_PUSH(epub, v) \
+  ((v).count < (v).alloc || \
+   ((v).items = _vector_grow((epub), (v).items, &(v).alloc, \
+                             sizeof(*(v).items)), \
+    (v).count < (v).alloc) ? \
+   memset(&(v).items[(v).count++], 0, sizeof(*(v).items)) : NULL)
+
+// Appends value to the VECTOR v. Evaluates to 0 or to -1 when out of memory
+#define VECTOR_ADD(epub, v, value) \
+  (VECTOR_PUSH(epub, v) ? ((v).items[(v).count - 1] = (value), 0) : -1)
+
 // An OCF root 
 struct root {
   xmlChar *mediatype; // media type (mime)
@@ -53,10 +76,91 @@ struct root {
 };
 
 
+// Access pattern hints for mapped archives
+enum ocf_access {
+  OCF_ACCESS_RANDOM, // metadata lookups all over the archive
+  OCF_ACCESS_SEQUENTIAL // reading the book in spine order
+};
+
+// Who owns the archive bytes in ocf->map
+enum ocf_map_kind {
+  OCF_MAP_FILE, // mapping of the file, unmapped on close
+  OCF_MAP_OWNED, // malloc()ed buffer, freed on close
+  OCF_MAP_BORROWED // caller's buffer, left alone
+};
+
+// Central directory record of a mapped archive
+struct ocf_rawentry {
+  zip_uint64_t offset; // local header offset
+  zip_uint64_t compSize;
+  zip_uint64_t size;
+  zip_uint16_t method; // compression method
+  zip_uint16_t flags; // general purpose bits
+  zip_uint32_t crc; // crc32 of the uncompressed data
+  int direct; // bool, data can be read straight from the mapping
+};
+
+// Decodes srcLen bytes of raw entry data into exactly dstLen bytes
+// Returns 0 or -1 on failure
+typedef int (*OcfInflateFunc)(const char *src, size_t srcLen, 
+                              char *dst, size_t dstLen);
+
+// Single shot decoder of a zip compression method
+struct ocf_decompressor {
+  zip_uint16_t method; // ZIP_CM_*
+  OcfInflateFunc inflate;
+};
+
+// A reference counted decompressed archive entry
+struct ocf_blob {
+  zip_int64_t index; // zip entry index
+  char *data; // the entry, null terminated
+  int size;
+  int refs; // references held by readers and the cache
+  struct ocf_blob *prev, *next; // cache LRU list
+};
+
+// LRU cache of decompressed entries
+struct ocf_cache {
+  size_t budget; // max bytes cached (0 = disabled)
+  size_t used; // bytes cached
+  struct ocf_blob **entries; // cached blobs by zip index
+  zip_int64_t count; // size of entries
+  struct ocf_blob *head, *tail; // most and least recently used
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+};
+
+// Inflater state at some point of a deflated entry
+struct ocf_checkpoint {
+  zip_uint64_t out; // uncompressed offset
+  zip_uint64_t in; // compressed offset of the next whole byte
+  int bits; // bits of the byte before in still to be inflated
+  unsigned char *window; // last 32k of output (NULL at the start)
+};
+
+// Checkpoints of an entry read in byte ranges
+struct ocf_range_index {
+  zip_int64_t index; // zip entry index
+  struct ocf_checkpoint *points; // by offset, points[0] is the start
+  int count;
+  int alloc;
+  struct ocf_range_index *next;
+};
+
 struct ocf {
   char *datapath; // The path that the data files relative to 
   char *filename; // The ebook filename
   struct zip *arch; // The epub zip
+  void *map; // The archive bytes (NULL if read through libzip)
+  size_t mapSize; // The mapping length
+  enum ocf_map_kind mapKind; // how map is released
+  int seqReaders; // Number of spine iterators reading the mapping
+  struct ocf_rawentry *raw; // central directory of the mapping
+  zip_int64_t rawCount; // entries in raw (-1 if not available)
+  struct ocf_cache cache; // decompressed entries
+  struct ocf_range_index *ranges; // entries read in byte ranges
   char *mimetype; // For debugging 
   listPtr roots; // list of OCF roots
   struct epub *epub; // back pointer
@@ -86,34 +190,39 @@ struct creator {
   xmlChar *role;
 };
 
+// Every category in document order
 struct metadata {
-  listPtr id;
-  listPtr title;
-  listPtr creator;
-  listPtr contrib;
-  listPtr subject;
-  listPtr publisher;
-  listPtr description;
-  listPtr date;
-  listPtr type;
-  listPtr format;
-  listPtr source;
-  listPtr lang;
-  listPtr relation;
-  listPtr coverage;
-  listPtr rights;
-  listPtr meta;
+  VECTOR(struct id) id;
+  VECTOR(xmlChar *) title;
+  VECTOR(struct creator) creator;
+  VECTOR(struct creator) contrib;
+  VECTOR(xmlChar *) subject;
+  VECTOR(xmlChar *) publisher;
+  VECTOR(xmlChar *) description;
+  VECTOR(struct date) date;
+  VECTOR(xmlChar *) type;
+  VECTOR(xmlChar *) format;
+  VECTOR(xmlChar *) source;
+  VECTOR(xmlChar *) lang;
+  VECTOR(xmlChar *) relation;
+  VECTOR(xmlChar *) coverage;
+  VECTOR(xmlChar *) rights;
+  VECTOR(struct meta) meta;
 };
 
+// The strings of manifest items and toc items are offsets in
+// epub->strings (0 for none), see _epub_str
 struct manifest {
-  xmlChar *nspace; 
-  xmlChar *modules; 
-  xmlChar *id;
-  xmlChar *href;
-  xmlChar *type;
-  xmlChar *fallback;
-  xmlChar *fbStyle;
-
+  zip_int64_t index; // zip entry index of path (-1 if missing)
+  uint32_t nspace; 
+  uint32_t modules; 
+  uint32_t id;
+  uint32_t href;
+  uint32_t type; // interned
+  uint32_t fallback;
+  uint32_t fbStyle;
+  uint32_t path; // canonical archive path of href
+  int spineIndex; // first position in the spine (-1 if not in it)
 };
     
 struct guide {
@@ -130,23 +239,25 @@ struct site {
 struct tour {
   xmlChar *id;
   xmlChar *title;
-  listPtr sites;
+  VECTOR(struct site) sites;
 };
 
 // Struct for navLabel and navInfo
 struct tocLabel {
-  xmlChar *lang;
-  xmlChar *dir;
+  xmlChar *lang; // interned
+  xmlChar *dir; // interned
   xmlChar *text;
 };
 
 // struct for navPoint, pageTarget, navTarget 
 struct tocItem {
-  xmlChar *id;
-  xmlChar *src;
-  xmlChar *class;
-  xmlChar *type; //pages
-  listPtr label;
+  uint32_t id;
+  uint32_t src;
+  uint32_t class; // interned
+  uint32_t type; //pages, interned
+  int label; // first of its labels in toc->labels
+  int labelCount;
+  xmlChar *text; // the label shown, see _opf_resolve_toc_labels
   int depth;
   int playOrder;
   int value;
@@ -155,10 +266,11 @@ struct tocItem {
 // struct for navMap, pageList, navList
 struct tocCategory {
   xmlChar *id;
-  xmlChar *class;
-  listPtr info; //tocLabel
-  listPtr label; //tocLabel
-  listPtr items; //tocItem
+  xmlChar *class; // interned
+  VECTOR(struct tocLabel) info;
+  VECTOR(struct tocLabel) label;
+  xmlChar *text; // the label shown (NULL for none)
+  VECTOR(struct tocItem) items; // in document order
 };
 
 // General toc struct
@@ -166,28 +278,89 @@ struct toc {
   struct tocCategory *navMap; 
   struct tocCategory *pageList;
   struct tocCategory *navList;
-  listPtr playOrder;
+  VECTOR(struct tocLabel) labels; // of all the items
 };
 
+// number of eiterator_type values
+#define EITERATOR_TYPES 3
+
 struct spine {
   xmlChar *idref;
   int linear; //bool
   enum page_spread_position spreadPosition;
+  struct manifest *item; // manifest item of idref (NULL if missing)
+  int orderPos[EITERATOR_TYPES]; // position among the items of every type
+};
+
+// Spine positions of the items an iterator type goes through
+struct spine_order {
+  int *positions;
+  int count;
 };
 
+// Elements the OPF and NCX readers dispatch on: name, length, first and
+// last letter in lower case, see _opf_element
+#define OPF_ELEMENTS(X) \
+  X(METADATA, "metadata", 8, 'm', 'a') \
+  X(DC_METADATA, "dc-metadata", 11, 'd', 'a') \
+  X(X_METADATA, "x-metadata", 10, 'x', 'a') \
+  X(IDENTIFIER, "identifier", 10, 'i', 'r') \
+  X(TITLE, "title", 5, 't', 'e') \
+  X(CREATOR, "creator", 7, 'c', 'r') \
+  X(CONTRIBUTOR, "contributor", 11, 'c', 'r') \
+  X(META, "meta", 4, 'm', 'a') \
+  X(DATE, "date", 4, 'd', 'e') \
+  X(SUBJECT, "subject", 7, 's', 't') \
+  X(PUBLISHER, "publisher", 9, 'p', 'r') \
+  X(DESCRIPTION, "description", 11, 'd', 'n') \
+  X(TYPE, "type", 4, 't', 'e') \
+  X(FORMAT, "format", 6, 'f', 't') \
+  X(SOURCE, "source", 6, 's', 'e') \
+  X(LANGUAGE, "language", 8, 'l', 'e') \
+  X(RELATION, "relation", 8, 'r', 'n') \
+  X(COVERAGE, "coverage", 8, 'c', 'e') \
+  X(RIGHTS, "rights", 6, 'r', 's') \
+  X(NAVMAP, "navMap", 6, 'n', 'p') \
+  X(NAVPOINT, "navPoint", 8, 'n', 't') \
+  X(NAVLIST, "navList", 7, 'n', 't') \
+  X(NAVTARGET, "navTarget", 9, 'n', 't') \
+  X(PAGELIST, "pageList", 8, 'p', 't') \
+  X(PAGETARGET, "pageTarget", 10, 'p', 't') \
+  X(NAVLABEL, "navLabel", 8, 'n', 'l') \
+  X(NAVINFO, "navInfo", 7, 'n', 'o') \
+  X(TEXT, "text", 4, 't', 't') \
+  X(CONTENT, "content", 7, 'c', 't')
+
+#define OPF_METADATA_VALUES 3 // attributes kept by a metadata element
+
+#define OPF_ELEMENT_ENUM(id, name, len, first, last) OPF_ELEMENT_##id,
+enum opf_element {
+  OPF_ELEMENT_OTHER, // none of OPF_ELEMENTS
+  OPF_ELEMENTS(OPF_ELEMENT_ENUM)
+};
+#undef OPF_ELEMENT_ENUM
+
 struct opf {
   char *name;
   xmlChar *tocName;
   struct epub *epub;
   struct metadata *metadata;
-  struct toc *toc; // must in opf 2.0
-  listPtr manifest;
-  listPtr spine;
+  struct toc *toc; // must in opf 2.0 (NULL until loaded)
+  int tocLoaded; // bool, _opf_load_toc was called
+  struct manifest *manifest; // in document order
+  int manifestCount;
+  int manifestAlloc; // allocated items
+  struct hash *manifestById; // manifest items by id
+  struct hash *manifestByPath; // manifest items by archive path
+  VECTOR(struct spine) *spine; // in reading order
   int linearCount;
+  struct spine_order spineOrders[EITERATOR_TYPES]; // by eiterator_type
     
   // might be NULL
-  listPtr guide;
-  listPtr tours;
+  VECTOR(struct guide) *guide;
+  VECTOR(struct tour) *tours;
+  struct etocload *tocLoad; // the toc worker, with EPUB_OPEN_TOC
+  VECTOR(xmlChar *) labelLangs; // preferred toc label languages, interned
 };
 
 struct epuberr {
@@ -215,8 +388,12 @@ extern const char _epub_error_oom[];
 struct epub {
   struct ocf *ocf;
   struct opf *opf;
+  struct arena *arena; // everything parsed from the book
+  struct strpool *strings; // its strings
+  struct hash *interned; // strings of epub->strings shared by all uses
   struct epuberr error;
   int debug;
+  int flags; // epub_open_flags
 
 };
 
@@ -228,12 +405,60 @@ enum {
   DEBUG_VERBOSE
 };
 
+// A spine item being prefetched
+struct eprefetch_slot {
+  zip_int64_t index; // zip entry index
+  struct ocf_blob *blob; // the inflated entry once ready
+  int state; // empty, queued, busy or ready
+  int order; // distance from the reader
+};
+
+// Background inflation of upcoming spine items
+struct eprefetch {
+#ifndef _WIN32
+  pthread_t thread;
+  pthread_mutex_t lock; // guards everything but arch
+  pthread_cond_t cond; // signals slot state changes
+#endif
+  struct ocf *ocf; // read only while the worker runs
+  struct zip *arch; // the worker's archive handle
+  struct eprefetch_slot *slots;
+  int count; // number of slots
+  int stop; // bool, worker should exit
+  struct epub_prefetch_stats stats;
+};
+
+// The toc parsed on a worker thread while the rest of the package is read
+// (EPUB_OPEN_TOC). The worker builds it in a book of its own, whose arena
+// and strings stay around for the toc.
+struct etocload {
+#ifndef _WIN32
+  pthread_t thread;
+#endif
+  struct epub epub; // the worker's book
+  struct opf opf; // the worker's package, only the toc is filled in
+  struct ocf *ocf; // read only while the worker runs
+  struct zip *arch; // the worker's archive handle
+  zip_int64_t index; // of the toc
+  const xmlChar *name; // of the toc
+  int running; // bool, the worker wasn't joined yet
+};
+
 struct eiterator {
   enum eiterator_type type;
   struct epub *epub;
   int opt;
-  listnodePtr curr;
-  char *cache;
+  const struct spine_order *order;
+  int pos; // in order, -1 before the first and count after the last item
+  struct ocf_blob *cache;
+  struct eprefetch *prefetch; // NULL if not prefetching
+};
+
+struct estream {
+  struct epub *epub;
+  struct zip_file *file;
+  zip_uint64_t size; // uncompressed size of the file
+  zip_uint64_t pos; // bytes read so far
 };
 
 struct tit_info {
@@ -246,78 +471,174 @@ struct titerator {
   enum titerator_type type;
   struct epub *epub;
   int opt;
-  listnodePtr next;
+  int next; // index of the next item
   struct tit_info cache;
   int valid;
 };
 
 // Ocf functions
+struct ocf *_ocf_new(struct epub *epub);
 struct ocf *_ocf_parse(struct epub *epub, const char *filename);
+struct ocf *_ocf_parse_memory(struct epub *epub, const void *buf, 
+                              size_t size, int own);
+struct ocf *_ocf_parse_fd(struct epub *epub, int fd);
+struct ocf *_ocf_parse_archive(struct ocf *ocf);
+const char *_ocf_name(struct ocf *ocf);
 void _ocf_dump(struct ocf *ocf);
 void _ocf_close(struct ocf *ocf);
 struct zip *_ocf_open(struct ocf *ocf, const char *fileName);
+struct zip *_ocf_open_mapped(struct ocf *ocf, const char *fileName);
+struct zip *_ocf_open_map(struct ocf *ocf, const char *name);
+struct zip *_ocf_open_buffer(const void *data, size_t size, 
+                             zip_error_t *error);
+int _ocf_map_fd(struct ocf *ocf, int fd);
+int _ocf_read_fd(struct ocf *ocf, int fd);
+void _ocf_advise(struct ocf *ocf, enum ocf_access access);
 int _ocf_get_file(struct ocf *ocf, const char *filename, char **fileStr);
+int _ocf_get_file_index(struct ocf *ocf, zip_int64_t index, char **fileStr);
+int _ocf_stream_index(struct ocf *ocf, zip_int64_t index, char **fileStr);
+int _ocf_read_entry(struct ocf *ocf, struct zip *arch, zip_int64_t index, 
+                    char **fileStr);
+struct zip *_ocf_open_clone(struct ocf *ocf);
 int _ocf_get_data_file(struct ocf *ocf, const char *filename, char **fileStr);
+char *_ocf_data_name(struct ocf *ocf, const char *filename);
+int _ocf_map_directory(struct ocf *ocf);
+const char *_ocf_raw_data(struct ocf *ocf, zip_int64_t index);
+int _ocf_get_view(struct ocf *ocf, const char *filename, struct epub_view *view);
+struct zip_file *_ocf_open_file(struct ocf *ocf, const char *filename, 
+                                zip_uint64_t *size);
+struct zip_file *_ocf_open_index(struct ocf *ocf, zip_int64_t index, 
+                                 zip_uint64_t *size);
 int _ocf_check_file(struct ocf *ocf, const char *filename);
 char *_ocf_root_by_type(struct ocf *ocf, const char *type);
 char *_ocf_root_fullpath_by_type(struct ocf *ocf, const char *type);
 
+// Decompressors
+int _ocf_decompress(struct ocf *ocf, zip_int64_t index, char **fileStr);
+const struct ocf_decompressor *_ocf_find_decompressor(zip_uint16_t method);
+int _ocf_inflate_store(const char *src, size_t srcLen,
+                       char *dst, size_t dstLen);
+int _ocf_inflate_deflate(const char *src, size_t srcLen,
+                         char *dst, size_t dstLen);
+
+// Byte ranges
+int _ocf_get_range(struct ocf *ocf, zip_int64_t index, zip_uint64_t offset,
+                   char *buf, int len);
+void _ocf_range_close(struct ocf *ocf);
+
+// Entry cache
+struct ocf_blob *_ocf_blob_get(struct ocf *ocf, zip_int64_t index);
+struct ocf_blob *_ocf_blob_new(zip_int64_t index, char *data, int size);
+struct ocf_blob *_ocf_cache_insert(struct ocf *ocf, struct ocf_blob *blob);
+void _ocf_blob_release(struct ocf_blob *blob);
+int _ocf_get_cached_index(struct ocf *ocf, zip_int64_t index, char **fileStr);
+void _ocf_cache_set_budget(struct ocf *ocf, size_t budget);
+void _ocf_cache_close(struct ocf *ocf);
+
+// Spine prefetching
+struct eprefetch *_epub_prefetch_start(struct eiterator *it, int depth);
+void _epub_prefetch_stop(struct eprefetch *pf);
+void _epub_prefetch_schedule(struct eprefetch *pf, zip_int64_t *indexes, 
+                             int count);
+struct ocf_blob *_epub_prefetch_take(struct eprefetch *pf, zip_int64_t index);
+
+// Extraction
+int _epub_extract_all(struct epub *epub, const char *dest, int nthreads);
+
 // Parsing ocf
 int _ocf_parse_container(struct ocf *ocf);
 int _ocf_parse_mimetype(struct ocf *ocf);
 
 // parsing opf
 struct opf *_opf_parse(struct epub *epub, char *opfStr);
+enum opf_element _opf_element(const xmlChar *name);
 void _opf_dump(struct opf *opf);
 void _opf_close(struct opf *opf);
 
+int _opf_read_package(struct opf *opf, char *opfStr);
 void _opf_parse_metadata(struct opf *opf, xmlTextReaderPtr reader);
+void _opf_init_metadata(struct opf *opf);
+void _opf_add_metadata(struct opf *opf, enum opf_element element,
+                       const xmlChar *localName, xmlChar *string,
+                       xmlChar **values);
 void _opf_parse_spine(struct opf *opf, xmlTextReaderPtr reader);
+void _opf_set_spine_properties(struct opf *opf, struct spine *item,
+                               const xmlChar *linear,
+                               const xmlChar *properties);
 void _opf_parse_manifest(struct opf *opf, xmlTextReaderPtr reader);
+void _opf_begin_manifest(struct opf *opf);
+struct manifest *_opf_add_manifest_item(struct opf *opf);
+void _opf_resolve_manifest_item(struct opf *opf, struct manifest *item);
+void _opf_index_manifest(struct opf *opf);
 void _opf_parse_guide(struct opf *opf, xmlTextReaderPtr reader);
 void _opf_parse_tours(struct opf *opf, xmlTextReaderPtr reader);
 
 // parse toc
+void _opf_load_toc(struct opf *opf);
 void _opf_parse_toc(struct opf *opf, char *tocStr, int size);
+void _opf_read_toc(struct opf *opf, char *tocStr, int size);
 void _opf_parse_navlist(struct opf *opf, xmlTextReaderPtr reader);
 void _opf_parse_navmap(struct opf *opf, xmlTextReaderPtr reader);
 void _opf_parse_pagelist(struct opf *opf, xmlTextReaderPtr reader);
-struct tocLabel *_opf_parse_navlabel(struct opf *opf, xmlTextReaderPtr reader);
-void _opf_free_toc_category(struct tocCategory *tc);
-void _opf_free_toc(struct toc *toc);
-struct toc *_opf_init_toc();
-struct tocCategory *_opf_init_toc_category();
-
-xmlChar *_opf_label_get_by_lang(struct opf *opf, listPtr label, char *lang);
-xmlChar *_opf_label_get_by_doc_lang(struct opf *opf, listPtr label);
+int _opf_parse_navlabel(struct opf *opf, xmlTextReaderPtr reader,
+                        struct tocLabel *label);
+void _opf_add_label(struct opf *opf, struct tocCategory *tc, 
+                    struct tocItem *item, int info, struct tocLabel *label);
+void _opf_init_toc_item(struct tocItem *item, int depth);
+struct toc *_opf_init_toc(struct opf *opf);
+struct tocCategory *_opf_init_toc_category(struct opf *opf);
+
+xmlChar *_opf_label_get_by_lang(struct opf *opf, struct tocLabel *labels,
+                                int count, const char *lang);
+xmlChar *_opf_label_get_by_doc_lang(struct opf *opf, struct tocLabel *labels,
+                                    int count);
+xmlChar *_opf_label_get_preferred(struct opf *opf, struct tocLabel *labels,
+                                  int count);
+void _opf_resolve_toc_labels(struct opf *opf);
 
 struct manifest *_opf_manifest_get_by_id(struct opf *opf, xmlChar* id);
+struct manifest *_opf_manifest_get_by_href(struct opf *opf, const char *href);
+int _opf_index_spine(struct opf *opf);
+
+// SAX2 parsing of the package and toc (EPUB_OPEN_SAX)
+int _opf_sax_package(struct opf *opf, const char *opfStr, int size);
+void _opf_sax_toc(struct opf *opf, const char *tocStr, int size);
+
+// Toc parsing on a worker thread (EPUB_OPEN_TOC)
+void _opf_toc_start(struct opf *opf);
+void _opf_toc_join(struct opf *opf);
+void _opf_toc_free(struct etocload *tl);
 
 // epub functions
 struct epub *epub_open(const char *filename, int debug);
+struct epub *epub_open_ex(const char *filename, int flags, int debug);
+struct epub *_epub_new(int flags, int debug);
+int _epub_new_pools(struct epub *epub);
+void _epub_free_pools(struct epub *epub);
+struct epub *_epub_parse(struct epub *epub);
 void _epub_print_debug(struct epub *epub, int debug, const char *format, ...) PRINTF_FORMAT(3, 4);
+xmlChar *_epub_xml_attribute(struct epub *epub, xmlTextReaderPtr reader,
+                             const char *name);
+xmlChar *_epub_xml_string(struct epub *epub, xmlTextReaderPtr reader);
+uint32_t _epub_xml_attribute_offset(struct epub *epub, xmlTextReaderPtr reader,
+                                    const char *name);
+xmlChar *_epub_str(struct epub *epub, uint32_t offset);
+xmlChar *_epub_intern(struct epub *epub, const xmlChar *str);
+xmlChar *_epub_xml_attribute_interned(struct epub *epub, 
+                                      xmlTextReaderPtr reader, 
+                                      const char *name);
 char *epub_last_errStr(struct epub *epub);
 
 // List operations
-void _list_free_root(struct root *data);
-
-void _list_free_creator(struct creator *data);
-void _list_free_date(struct date *date);
-void _list_free_id(struct id *id);
-void _list_free_meta(struct meta *meta);
-
-void _list_free_spine(struct spine *spine);
-void _list_free_manifest(struct manifest *manifest);
-void _list_free_guide(struct guide *guide);
-void _list_free_tours(struct tour *tour);
-
-void _list_free_toc_label(struct tocLabel *tl);
-void _list_free_toc_item(struct tocItem *ti);
+listPtr _list_new(struct epub *epub, NodeCompareFunc compare);
+void *_vector_grow(struct epub *epub, void *items, int *alloc, size_t size);
 
 int _list_cmp_root_by_mediatype(struct root *root1, struct root *root2);
-int _list_cmp_manifest_by_id(struct manifest *m1, struct manifest *m2);
-int _list_cmp_toc_by_playorder(struct tocItem *t1, struct tocItem *t2);
-int _list_cmp_label_by_lang(struct tocLabel *t1, struct tocLabel *t2);
+
+const char *_list_key_string(char *str, void *data);
+const char *_list_key_manifest_id(struct manifest *m, struct strpool *strings);
+const char *_list_key_manifest_path(struct manifest *m, 
+                                    struct strpool *strings);
 
 void _list_dump_root(struct root *root);
 
@@ -0,0 +1,250 @@
+#include "epublib.h"
+#include "path.h"
+
+#include <stdio.h>
+#ifdef _WIN32
+# include <direct.h>
+# define mkdir(path, mode) _mkdir(path)
+#else
+# include <sys/stat.h>
+# include <sys/types.h>
+#endif
+
+// Extraction of the whole archive to a directory. The entries are handed
+// out to the workers one by one, each worker reads through its own
+// archive handle and records per entry errors which are reported once
+// all of them are done.
+
+#define EXTRACT_BUFFER_SIZE 65536
+#define EXTRACT_PENDING -1 // entry wasn't handled by any worker
+
+struct eextract {
+#ifndef _WIN32
+  pthread_mutex_t lock; // guards next
+#endif
+  struct ocf *ocf;
+  const char *dest;
+  zip_int64_t next; // next entry to hand out
+  zip_int64_t count; // number of entries
+  int *status; // errno of every entry, 0 on success
+};
+
+// Creates the directory path and its parents
+int _epub_extract_mkdirs(char *path) {
+  char *p;
+
+  for (p = strchr(path + 1, '/'); p; p = strchr(p + 1, '/')) {
+    *p = 0;
+    if (mkdir(path, 0755) == -1 && errno != EEXIST) {
+      *p = '/';
+      return -1;
+    }
+    *p = '/';
+  }
+
+  if (mkdir(path, 0755) == -1 && errno != EEXIST)
+    return -1;
+
+  return 0;
+}
+
+// Writes the entry at index under the destination directory.
+// Returns 0 or the errno of the failure
+int _epub_extract_entry(struct eextract *ex, struct zip *arch,
+                        zip_int64_t index, char *buf) {
+  struct zip_file *file;
+  const char *name;
+  char *canon, *path, *slash;
+  FILE *out;
+  zip_int64_t len;
+  int ret = 0;
+
+  if (! (name = zip_get_name(arch, index, 0)))
+    return EIO;
+
+  // canonical names never climb out of the destination
+  if (! (canon = canonicalize_filename(name)))
+    return ENOMEM;
+  if (! canon[0]) {
+    free(canon);
+    return EINVAL;
+  }
+
+  path = malloc(strlen(ex->dest) + strlen(canon) + 2);
+  if (! path) {
+    free(canon);
+    return ENOMEM;
+  }
+  sprintf(path, "%s/%s", ex->dest, canon);
+  free(canon);
+
+  // directory entry
+  if (name[strlen(name) - 1] == '/') {
+    if (_epub_extract_mkdirs(path) == -1)
+      ret = errno;
+    free(path);
+    return ret;
+  }
+
+  slash = strrchr(path, '/');
+  *slash = 0;
+  if (_epub_extract_mkdirs(path) == -1) {
+    ret = errno;
+    free(path);
+    return ret;
+  }
+  *slash = '/';
+
+  if (! (file = zip_fopen_index(arch, index, 0))) {
+    free(path);
+    return EIO;
+  }
+
+  if (! (out = fopen(path, "wb"))) {
+    ret = errno;
+    zip_fclose(file);
+    free(path);
+    return ret;
+  }
+
+  while ((len = zip_fread(file, buf, EXTRACT_BUFFER_SIZE)) > 0) {
+    if (fwrite(buf, 1, len, out) != (size_t)len) {
+      ret = errno ? errno : EIO;
+      break;
+    }
+  }
+  if (len == -1)
+    ret = EIO;
+
+  if (zip_fclose(file) == -1 && ! ret)
+    ret = EIO;
+  if (fclose(out) == EOF && ! ret)
+    ret = errno;
+
+  // don't leave truncated files behind
+  if (ret)
+    remove(path);
+
+  free(path);
+  return ret;
+}
+
+void *_epub_extract_worker(void *arg) {
+  struct eextract *ex = arg;
+  struct zip *arch;
+  zip_int64_t index;
+  char *buf;
+
+  if (! (buf = malloc(EXTRACT_BUFFER_SIZE)))
+    return NULL;
+
+  if (! (arch = _ocf_open_clone(ex->ocf))) {
+    free(buf);
+    return NULL;
+  }
+
+  for (;;) {
+#ifndef _WIN32
+    pthread_mutex_lock(&ex->lock);
+#endif
+    index = ex->next < ex->count ? ex->next++ : -1;
+#ifndef _WIN32
+    pthread_mutex_unlock(&ex->lock);
+#endif
+
+    if (index == -1)
+      break;
+
+    ex->status[index] = _epub_extract_entry(ex, arch, index, buf);
+  }
+
+  zip_discard(arch);
+  free(buf);
+
+  return NULL;
+}
+
+int _epub_extract_all(struct epub *epub, const char *dest, int nthreads) {
+  struct eextract ex;
+  zip_int64_t i;
+  char *root;
+  int failed = 0;
+#ifndef _WIN32
+  pthread_t *threads;
+  int started;
+#endif
+
+  memset(&ex, 0, sizeof(struct eextract));
+  ex.ocf = epub->ocf;
+  ex.dest = dest;
+  ex.count = zip_get_num_entries(epub->ocf->arch, ZIP_FL_UNCHANGED);
+
+  if (! (root = strdup(dest))) {
+    _epub_err_set_oom(&epub->error);
+    return -1;
+  }
+  if (_epub_extract_mkdirs(root) == -1) {
+    _epub_print_debug(epub, DEBUG_ERROR, "%s - %s", dest, strerror(errno));
+    free(root);
+    return -1;
+  }
+  free(root);
+
+  if (ex.count <= 0)
+    return 0;
+
+  ex.status = malloc(ex.count * sizeof(int));
+  if (! ex.status) {
+    _epub_err_set_oom(&epub->error);
+    return -1;
+  }
+  for (i = 0; i < ex.count; i++)
+    ex.status[i] = EXTRACT_PENDING;
+
+  if (nthreads < 1)
+    nthreads = 1;
+  if (nthreads > ex.count)
+    nthreads = (int)ex.count;
+
+#ifndef _WIN32
+  threads = malloc(nthreads * sizeof(pthread_t));
+  if (! threads) {
+    _epub_err_set_oom(&epub->error);
+    free(ex.status);
+    return -1;
+  }
+
+  pthread_mutex_init(&ex.lock, NULL);
+  for (started = 0; started < nthreads; started++) {
+    if (pthread_create(&threads[started], NULL,
+                       _epub_extract_worker, &ex) != 0)
+      break;
+  }
+
+  // no thread could be started, do the work here
+  if (! started)
+    _epub_extract_worker(&ex);
+
+  while (started > 0)
+    pthread_join(threads[--started], NULL);
+  pthread_mutex_destroy(&ex.lock);
+  free(threads);
+#else
+  _epub_extract_worker(&ex);
+#endif
+
+  for (i = 0; i < ex.count; i++) {
+    if (! ex.status[i])
+      continue;
+
+    failed++;
+    _epub_print_debug(epub, DEBUG_WARNING, "can't extract %s - %s",
+                      zip_get_name(epub->ocf->arch, i, 0),
+                      ex.status[i] == EXTRACT_PENDING ?
+                      "archive could not be opened" : strerror(ex.status[i]));
+  }
+
+  free(ex.status);
+
+  return failed;
+}
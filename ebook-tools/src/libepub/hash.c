@@ -0,0 +1,111 @@
+#include "hash.h"
+#include <stdlib.h>
+
+#define HASH_MIN_SIZE 16
+
+size_t hash_string(const char *str)
+{
+  size_t h = 2166136261u;
+
+  while (*str) {
+    h ^= (unsigned char)*str++;
+    h *= 16777619u;
+  }
+
+  return h;
+}
+
+struct hash *hash_new(HashKeyFunc key, void *data, size_t hint)
+{
+  struct hash *hash = malloc(sizeof(struct hash));
+
+  if (!hash)
+    return NULL;
+
+  // keep the load under 3/4
+  hash->size = HASH_MIN_SIZE;
+  while (hash->size / 4 * 3 < hint)
+    hash->size *= 2;
+
+  hash->slots = calloc(hash->size, sizeof(void *));
+  if (!hash->slots) {
+    free(hash);
+    return NULL;
+  }
+  hash->count = 0;
+  hash->key = key;
+  hash->data = data;
+
+  return hash;
+}
+
+void hash_free(struct hash *hash)
+{
+  if (!hash)
+    return;
+
+  free(hash->slots);
+  free(hash);
+}
+
+// returns the slot of key: either its item or the empty slot to put it in
+size_t hash_find(const struct hash *hash, const char *key)
+{
+  size_t mask = hash->size - 1;
+  size_t i = hash_string(key) & mask;
+
+  while (hash->slots[i] && strcmp(hash->key(hash->slots[i], hash->data), key))
+    i = (i + 1) & mask;
+
+  return i;
+}
+
+int hash_grow(struct hash *hash)
+{
+  void **old = hash->slots;
+  size_t oldSize = hash->size;
+  size_t i;
+
+  hash->slots = calloc(oldSize * 2, sizeof(void *));
+  if (!hash->slots) {
+    hash->slots = old;
+    return -1;
+  }
+  hash->size = oldSize * 2;
+
+  for (i = 0; i < oldSize; i++) {
+    if (old[i])
+      hash->slots[hash_find(hash, hash->key(old[i], hash->data))] = old[i];
+  }
+
+  free(old);
+  return 0;
+}
+
+int hash_add(struct hash *hash, void *item)
+{
+  size_t i;
+
+  if (!item || !hash->key(item, hash->data))
+    return -1;
+
+  if (hash->count + 1 > hash->size / 4 * 3 && hash_grow(hash) == -1)
+    return -1;
+
+  i = hash_find(hash, hash->key(item, hash->data));
+  if (hash->slots[i])
+    return 0;
+
+  hash->slots[i] = item;
+  hash->count++;
+
+  return 1;
+}
+
+void *hash_get(const struct hash *hash, const char *key)
+{
+  if (!hash || !key)
+    return NULL;
+
+  return hash->slots[hash_find(hash, key)];
+}
@@ -0,0 +1,44 @@
+#ifndef HASH_H
+#define HASH_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+
+// Returns the key string of an item stored in a hash, data is the one
+// given to hash_new
+typedef const char *(*HashKeyFunc)(void *item, void *data);
+
+// A string keyed hash of items (open addressing). The items aren't 
+// owned, their keys must not change while they are in the hash.
+struct hash {
+  void **slots;
+  size_t size; // number of slots, a power of 2
+  size_t count; // number of items
+  HashKeyFunc key;
+  void *data; // passed to key
+};
+
+// Allocates a hash for about hint items, returns NULL on failure
+struct hash *hash_new(HashKeyFunc key, void *data, size_t hint);
+
+// Frees the hash but not the items
+void hash_free(struct hash *hash);
+
+// Adds item unless an item with the same key is already there.
+// Returns 1 if added, 0 for a duplicate key and -1 on failure
+int hash_add(struct hash *hash, void *item);
+
+// Returns the item with the given key or NULL
+void *hash_get(const struct hash *hash, const char *key);
+
+// FNV-1a hash of a string
+size_t hash_string(const char *str);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HASH_H
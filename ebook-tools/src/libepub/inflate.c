@@ -0,0 +1,97 @@
+#include "epublib.h"
+
+#include <limits.h>
+
+// Decompressors for entries whose raw data is in memory. The sizes are
+// known from the central directory, so the whole entry is decoded in one
+// call into a buffer of the exact size instead of going through the
+// libzip streaming reader. Compression methods without a decompressor
+// here are left to libzip.
+
+// Copies stored entries
+int _ocf_inflate_store(const char *src, size_t srcLen,
+                       char *dst, size_t dstLen) {
+  if (srcLen != dstLen)
+    return -1;
+
+  memcpy(dst, src, dstLen);
+  return 0;
+}
+
+// Inflates raw deflate data
+int _ocf_inflate_deflate(const char *src, size_t srcLen,
+                         char *dst, size_t dstLen) {
+  z_stream strm;
+  int ret;
+
+  if (srcLen > UINT_MAX || dstLen > UINT_MAX)
+    return -1;
+
+  memset(&strm, 0, sizeof(z_stream));
+  if (inflateInit2(&strm, -MAX_WBITS) != Z_OK)
+    return -1;
+
+  strm.next_in = (Bytef *)src;
+  strm.avail_in = (uInt)srcLen;
+  strm.next_out = (Bytef *)dst;
+  strm.avail_out = (uInt)dstLen;
+
+  ret = inflate(&strm, Z_FINISH);
+  inflateEnd(&strm);
+
+  return ret == Z_STREAM_END && strm.total_out == dstLen ? 0 : -1;
+}
+
+static const struct ocf_decompressor _ocf_decompressors[] = {
+  { ZIP_CM_STORE, _ocf_inflate_store },
+  { ZIP_CM_DEFLATE, _ocf_inflate_deflate },
+  { 0, NULL }
+};
+
+// Returns the decompressor for a compression method or NULL
+const struct ocf_decompressor *_ocf_find_decompressor(zip_uint16_t method) {
+  const struct ocf_decompressor *dec;
+
+  for (dec = _ocf_decompressors; dec->inflate; dec++) {
+    if (dec->method == method)
+      return dec;
+  }
+
+  return NULL;
+}
+
+// Decodes the entry at index straight from the archive bytes into a null
+// terminated buffer. Returns the size of the entry or -1 if it has to be
+// read through libzip: the archive isn't in memory, the entry is zip64
+// or encrypted, its method has no decompressor or the data is corrupt
+// (libzip then reports the error). Safe to call from worker threads once
+// the directory is mapped.
+int _ocf_decompress(struct ocf *ocf, zip_int64_t index, char **fileStr) {
+  const struct ocf_decompressor *dec;
+  struct ocf_rawentry *entry;
+  const char *raw;
+
+  *fileStr = NULL;
+
+  if (ocf->rawCount <= 0 || ! (raw = _ocf_raw_data(ocf, index)))
+    return -1;
+
+  entry = &ocf->raw[index];
+  if (! (dec = _ocf_find_decompressor(entry->method)) ||
+      entry->size >= INT_MAX)
+    return -1;
+
+  if (! (*fileStr = malloc(entry->size + 1)))
+    return -1;
+
+  if (dec->inflate(raw, entry->compSize, *fileStr, entry->size) == -1 ||
+      crc32(crc32(0L, Z_NULL, 0), (Bytef *)*fileStr,
+            (uInt)entry->size) != entry->crc) {
+    free(*fileStr);
+    *fileStr = NULL;
+    return -1;
+  }
+  (*fileStr)[entry->size] = 0;
+
+  return (int)entry->size;
+}
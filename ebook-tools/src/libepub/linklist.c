@@ -21,6 +21,8 @@ listPtr NewListAlloc(int ListType, ListAlloc Lalloc, ListFreeFunc Lfree,
       List->Current  = List->Head = List->Tail = NULL;
       List->memalloc = Lalloc;
       List->memfree  = Lfree;
+      List->poolalloc = NULL;
+      List->pool     = NULL;
       List->compare  = Cfunc;
       List->Size     = 0;
       List->Flags    = ListType;
@@ -29,6 +31,32 @@ listPtr NewListAlloc(int ListType, ListAlloc Lalloc, ListFreeFunc Lfree,
   return List;
 } /* NewListAlloc() */
 
+static void PoolFree(void *Ptr)
+{
+  /* Pool memory goes away with the pool */
+  (void)Ptr;
+} /* PoolFree() */
+
+listPtr NewListPool(int ListType, ListPoolAlloc Palloc, void *Pool,
+		    NodeCompareFunc Cfunc)
+{
+  listPtr List;
+
+  if ((List = (listPtr)((Palloc)(Pool, sizeof(struct LList)))) != NULL)
+    {
+      List->Current  = List->Head = List->Tail = NULL;
+      List->memalloc = NULL;
+      List->memfree  = PoolFree;
+      List->poolalloc = Palloc;
+      List->pool     = Pool;
+      List->compare  = Cfunc;
+      List->Size     = 0;
+      List->Flags    = ListType;
+    }
+
+  return List;
+} /* NewListPool() */
+
 listnodePtr NewListNode(listPtr List, void *Data)
 {
   listnodePtr Node;
@@ -39,7 +67,13 @@ listnodePtr NewListNode(listPtr List, void *Data)
   else
     Alloc = List->memalloc;
     
-  if ((Node = (listnodePtr)((Alloc(sizeof(struct ListNode))))) != NULL)
+  if ((List != NULL) && (List->poolalloc != NULL))
+    Node = (listnodePtr)((List->poolalloc)(List->pool, 
+					    sizeof(struct ListNode)));
+  else
+    Node = (listnodePtr)((Alloc(sizeof(struct ListNode))));
+
+  if (Node != NULL)
     {
        Node->Data = Data;
        Node->Next = Node->Prev = NULL;
@@ -497,36 +531,88 @@ void SwapList(listPtr List)
   return;
 } /* SwapList() */
 
+static listnodePtr MergeLists(listPtr List, listnodePtr First, 
+			      listnodePtr Second)
+{
+  struct ListNode Merged;
+  listnodePtr Tail;
+
+  /* Merges two sorted chains linked through Next.  Ties are taken from
+     First so that equal nodes keep their order. */
+
+  Tail = &Merged;
+  while ((First != NULL) && (Second != NULL))
+    {
+      if ((List->compare)(First->Data, Second->Data) <= 0)
+	{
+	  Tail->Next = First;
+	  First = First->Next;
+	}
+      else
+	{
+	  Tail->Next = Second;
+	  Second = Second->Next;
+	}
+      Tail = Tail->Next;
+    }
+  Tail->Next = (First != NULL) ? First : Second;
+
+  return Merged.Next;
+} /* MergeLists() */
+
 void SortList(listPtr List)
 {
-  int Move;
+  listnodePtr Runs[sizeof(int) * 8];
+  listnodePtr Node, Next, Prev;
+  int Count, Max;
 
   if ((List == NULL) || (List->compare == NULL) ||
       ((List->Flags & LISTFLAGMASK) & LISTBTREE))
     return;
 
-  /* This is a DA-sort!! */
-
   if (List->Head == NULL)
     return;
 
-  Move = 1;
-  while (Move != 0)
+  /* Lists are usually built in order already; check that first */
+  for (Node = List->Head; Node->Next != NULL; Node = Node->Next)
+    if ((List->compare)(Node->Data, Node->Next->Data) > 0)
+      break;
+
+  if (Node->Next != NULL)
     {
-      Move = 0;
-      List->Current = List->Head;
-      while (List->Current->Next != NULL)
+      /* Bottom-up merge sort: Runs[i] is a sorted chain of 2^i nodes (or
+	 NULL).  Each node is merged in like a carry in binary addition.
+	 The sort is stable. */
+      Max = 0;
+      Node = List->Head;
+      while (Node != NULL)
 	{
-	  if ((List->compare)(List->Current->Data, 
-			      List->Current->Next->Data) > 0)
+	  Next = Node->Next;
+	  Node->Next = NULL;
+
+	  for (Count = 0; (Count < Max) && (Runs[Count] != NULL); Count++)
 	    {
-	      Move++;
-	      SwapList(List);
-	    };
+	      Node = MergeLists(List, Runs[Count], Node);
+	      Runs[Count] = NULL;
+	    }
+	  if (Count == Max)
+	    Max++;
+	  Runs[Count] = Node;
 
-	  if (List->Current->Next != NULL)
-	    List->Current = List->Current->Next;
+	  Node = Next;
 	}
+
+      Node = NULL;
+      for (Count = 0; Count < Max; Count++)
+	if (Runs[Count] != NULL)
+	  Node = (Node == NULL) ? Runs[Count] : 
+	    MergeLists(List, Runs[Count], Node);
+
+      /* Restore the back links */
+      List->Head = Node;
+      for (Prev = NULL; Node != NULL; Prev = Node, Node = Node->Next)
+	Node->Prev = Prev;
+      List->Tail = Prev;
     }
 
   List->Current = List->Head;
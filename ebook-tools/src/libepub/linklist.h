@@ -123,6 +123,9 @@ typedef void (*ListFreeFunc)(void *);
 typedef void *(* ListAlloc)(size_t size);
 /* Memory allocation procedure to use for this list (malloc() syntax) */
 
+typedef void *(* ListPoolAlloc)(void *Pool, size_t size);
+/* Memory allocation procedure of a pool the list lives in */
+
 typedef int (* NodeCompareFunc)(void *, void *);
 /* Function used to compare nodes for list sorting.  The two passed pointers
    are two data elements from nodes of a list.  CompareFunc must return:
@@ -153,6 +156,8 @@ typedef struct LList
                Flags;    /* Flags associated with List/Tree */
   ListAlloc    memalloc; /* malloc()-type procedure to use */
   ListFreeFunc memfree;  /* free()-type procedure to use */
+  ListPoolAlloc poolalloc; /* pool allocation procedure or NULL */
+  void         *pool;    /* Pool passed to poolalloc */
   NodeCompareFunc compare; /* Function to use to compare nodes */
 } llist;
 
@@ -187,6 +192,16 @@ listPtr NewListAlloc(int ListType, ListAlloc Lalloc, ListFreeFunc Lfree,
         Pointer to a new list
         NULL on error (Lalloc() procedure failed) */
 
+listPtr NewListPool(int ListType, ListPoolAlloc Palloc, void *Pool,
+		    NodeCompareFunc Cfunc);
+/* Create a list whose structure and nodes are allocated from Pool with
+   Palloc.  Memory is never given back to the pool: deleted nodes are 
+   released with the pool itself, FreeList() only calls its DataFree.
+
+   Returns
+        Pointer to a new list
+        NULL on error (Palloc() procedure failed) */
+
 #define NewList(Type) NewListAlloc(Type, NULL, NULL, NULL)
 /* Macro definition of: listPtr NewList(int ListType); 
    for compatibility with previous versions of library */
@@ -326,7 +341,8 @@ void SwapList(listPtr List);
    function if current node is tail of list.  */
 
 void SortList(listPtr List);
-/* Preforms a slow sort on the list.  Sort is handled in-place.  Current node
+/* Performs a stable merge sort on the list in O(n log n); an already
+   sorted list is only checked.  Sort is handled in-place.  Current node
    is head of list after sort.  Does not  attempt to sort lists with LISTBTREE
    property set.
 */
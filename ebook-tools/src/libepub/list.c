@@ -1,128 +1,23 @@
 #include "epublib.h"
 
-// Free root struct
-void _list_free_root(struct root *data) {
-  if (data->mediatype)
-    free(data->mediatype);
-  if (data->fullpath)
-    free(data->fullpath);
-  free(data);
+// Returns a list living in the arena of the epub
+listPtr _list_new(struct epub *epub, NodeCompareFunc compare) {
+  return NewListPool(LIST, (ListPoolAlloc)arena_alloc, epub->arena, compare);
 }
 
-void _list_free_creator(struct creator *data) {
-  if (data->name)
-    free(data->name);
-  if (data->fileAs)
-    free(data->fileAs);
-  if (data->role)
-    free(data->role);
-  free(data);
-}
-
-void _list_free_date(struct date *data) {
-  if (data->date)
-    free(data->date);
-  if (data->event)
-    free(data->event);  
-  free(data);
-}
-
-void _list_free_id(struct id *data) {
-  if (data->id)
-    free(data->id);
-  if (data->scheme)
-    free(data->scheme);
-  if (data->string)
-    free(data->string);
-  free(data);
-}
-
-void _list_free_meta(struct meta *data) {
-  if (data->name)
-    free(data->name);
-  if (data->content)
-    free(data->content);
-  free(data);
-}
-
-void _list_free_spine(struct spine *spine) {
-  if (spine->idref)
-    free(spine->idref);
-  free(spine);
-}
-
-void _list_free_guide(struct guide *guide) {
-  if (guide->href)
-    free(guide->href);
-  if (guide->type)
-    free(guide->type);
-  if (guide->title)
-    free(guide->title);
-  free(guide);
-}
-
-void _list_free_site(struct site *site) {
-  if (site->title)
-    free(site->title);
-  if (site->href)
-    free(site->href);
-  free(site);
-}
-
-void _list_free_tours(struct tour *tour) {
-  if (tour->id)
-    free(tour->id);
-  if (tour->title)
-    free(tour->title);
-      
-  FreeList(tour->sites, (ListFreeFunc)_list_free_site);
-  free(tour);
-}
+// Returns the items of a VECTOR with room for more. When out of memory
+// they are returned as they were and alloc is left alone.
+void *_vector_grow(struct epub *epub, void *items, int *alloc, size_t size) {
+  int grown = *alloc ? *alloc * 2 : 4;
+  void *tmp = arena_realloc(epub->arena, items, *alloc * size, grown * size);
 
-void _list_free_manifest(struct manifest *manifest) {
-
-  if (manifest->nspace)
-    free(manifest->nspace);
-  if (manifest->modules)
-    free(manifest->modules);
-  if (manifest->id)
-    free(manifest->id);
-  if (manifest->href)
-    free(manifest->href);
-  if (manifest->type)
-    free(manifest->type);
-  if (manifest->fallback)
-    free(manifest->fallback);
-  if (manifest->fbStyle)
-    free(manifest->fbStyle);
-
-  free(manifest);
-} 
-
-void _list_free_toc_label(struct tocLabel *tl) {
-  if (tl->lang)
-    free(tl->lang);
-  if (tl->dir)
-    free(tl->dir);
-  if (tl->text)
-    free(tl->text);
-  free(tl);
-}
-
-void _list_free_toc_item(struct tocItem *ti) {
-
-  if (ti->id)
-    free(ti->id);
-  if (ti->src)
-    free(ti->src);
-  if (ti->class)
-    free(ti->class);
-  if (ti->type)
-    free(ti->type);
-
-  FreeList(ti->label, (ListFreeFunc)_list_free_toc_label);
+  if (! tmp) {
+    _epub_err_set_oom(&epub->error);
+    return items;
+  }
+  *alloc = grown;
 
-  free(ti);
+  return tmp;
 }
 
 // Compare 2 root structs by mediatype field
@@ -131,30 +26,19 @@ int _list_cmp_root_by_mediatype(struct root *root1, struct root *root2) {
   return strcmp((char *)root1->mediatype, (char *)root2->mediatype);
 }
 
-int _list_cmp_manifest_by_id(struct manifest *m1, struct manifest *m2) {
-  return strcmp((char *)m1->id, (char *)m2->id);
+// Key of a hash of strings
+const char *_list_key_string(char *str, void *data) {
+  (void)data;
+  return str;
 }
 
-int _list_cmp_label_by_lang(struct tocLabel *t1, struct tocLabel *t2) {
-
-  if (! t1->lang || ! t2->lang)
-    return 0;
-
-  return strcmp((char *)t1->lang, (char *)t2->lang);;
+const char *_list_key_manifest_id(struct manifest *m, struct strpool *strings) {
+  return strpool_get(strings, m->id);
 }
 
-int _list_cmp_toc_by_playorder(struct tocItem *t1, struct tocItem *t2) {
-  
-  if ((t1 == NULL) || (t2 == NULL))
-    return 0;
-
-  if (t1->playOrder > t2->playOrder)
-    return 1;
-
-  if (t1->playOrder < t2->playOrder)
-    return -1;
-
-  return 0;
+const char *_list_key_manifest_path(struct manifest *m, 
+                                    struct strpool *strings) {
+  return strpool_get(strings, m->path);
 }
 
 // Print root 
@@ -268,6 +152,9 @@ void _list_dump_site(struct site *site) {
 }
 
 void _list_dump_tour(struct tour *tour) {
+  int i;
+
   printf("Tour %s(%s):\n", tour->title, tour->id);
-  DumpList(tour->sites, (ListDumpFunc)_list_dump_site);
+  for (i = 0; i < tour->sites.count; i++)
+    _list_dump_site(&tour->sites.items[i]);
 }
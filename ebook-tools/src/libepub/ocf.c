@@ -1,6 +1,15 @@
 #include "epublib.h"
 #include "path.h"
 
+#ifndef _WIN32
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#else
+# include <io.h>
+#endif
+
 int _ocf_parse_mimetype(struct ocf *ocf) {
 
   _epub_print_debug(ocf->epub, DEBUG_INFO, "looking for mime type");
@@ -54,7 +63,8 @@ int _ocf_parse_container(struct ocf *ocf) {
 		} else if (xmlStrcasecmp(xmlTextReaderConstLocalName(reader),
 								 (xmlChar *)"rootfile") == 0) {
 				
-			struct root *newroot = malloc(sizeof(struct root));
+			struct root *newroot = arena_alloc(ocf->epub->arena, 
+                                               sizeof(struct root));
 			if (! newroot) {
 				_epub_print_debug(ocf->epub, DEBUG_ERROR, "No memory left for root");
 				xmlFreeTextReader(reader);
@@ -62,9 +72,9 @@ int _ocf_parse_container(struct ocf *ocf) {
 				return 0;
 			}
 			newroot->mediatype = 
-				xmlTextReaderGetAttribute(reader, (xmlChar *)"media-type");
+				_epub_xml_attribute(ocf->epub, reader, "media-type");
 			newroot->fullpath =
-				xmlTextReaderGetAttribute(reader, (xmlChar *)"full-path");
+				_epub_xml_attribute(ocf->epub, reader, "full-path");
 			AddNode(ocf->roots, NewListNode(ocf->roots, newroot));
 			
 				_epub_print_debug(ocf->epub, DEBUG_INFO, 
@@ -90,8 +100,14 @@ int _ocf_parse_container(struct ocf *ocf) {
   return 1;
 }
 
+// Returns the ebook file name, or a placeholder for books opened from 
+// memory
+const char *_ocf_name(struct ocf *ocf) {
+  return ocf->filename ? ocf->filename : "(memory)";
+}
+
 void _ocf_dump(struct ocf *ocf) {  
-  printf("Filename:\t %s\n", ocf->filename);
+  printf("Filename:\t %s\n", _ocf_name(ocf));
 
   printf("Root(s):\n");
   DumpList(ocf->roots, (ListDumpFunc)_list_dump_root);
@@ -104,6 +120,9 @@ struct zip *_ocf_open(struct ocf *ocf, const char *filename) {
   char errStr[8192];
   struct zip *arch = NULL;
 
+  if (ocf->epub->flags & EPUB_OPEN_MMAP)
+    return _ocf_open_mapped(ocf, filename);
+
   if (! (arch = zip_open(filename, 0, &err))) {
     zip_error_to_str(errStr, sizeof(errStr), err, errno);
     _epub_print_debug(ocf->epub, DEBUG_ERROR, "%s - %s", filename, errStr); 
@@ -112,23 +131,198 @@ struct zip *_ocf_open(struct ocf *ocf, const char *filename) {
   return arch;
 }
 
+// Opens an archive held in memory through a libzip buffer source
+struct zip *_ocf_open_buffer(const void *data, size_t size, 
+                             zip_error_t *error) {
+  struct zip_source *src;
+  struct zip *arch = NULL;
+
+  if ((src = zip_source_buffer_create(data, size, 0, error))) {
+    if (! (arch = zip_open_from_source(src, ZIP_RDONLY, error)))
+      zip_source_free(src);
+  }
+
+  return arch;
+}
+
+// Opens the archive in ocf->map. name is only used for messages
+struct zip *_ocf_open_map(struct ocf *ocf, const char *name) {
+  struct zip *arch;
+  zip_error_t error;
+
+  // The central directory, container and opf are spread over the archive
+  _ocf_advise(ocf, OCF_ACCESS_RANDOM);
+
+  zip_error_init(&error);
+  if (! (arch = _ocf_open_buffer(ocf->map, ocf->mapSize, &error)))
+    _epub_print_debug(ocf->epub, DEBUG_ERROR, "%s - %s", 
+                      name, zip_error_strerror(&error));
+  zip_error_fini(&error);
+
+  return arch;
+}
+
+// Maps the whole file behind fd into ocf->map. Returns -1 on failure with
+// errno set (EINVAL for files that can't be mapped)
+int _ocf_map_fd(struct ocf *ocf, int fd) {
+#ifdef _WIN32
+  (void)ocf;
+  (void)fd;
+  errno = EINVAL;
+  return -1;
+#else
+  struct stat st;
+  void *map;
+
+  if (fstat(fd, &st) == -1)
+    return -1;
+
+  if (! S_ISREG(st.st_mode) || st.st_size == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED)
+    return -1;
+
+  ocf->map = map;
+  ocf->mapSize = st.st_size;
+  ocf->mapKind = OCF_MAP_FILE;
+
+  return 0;
+#endif
+}
+
+// Reads everything left in fd into a buffer owned by ocf->map
+int _ocf_read_fd(struct ocf *ocf, int fd) {
+  char *buf = NULL, *tmp;
+  size_t size = 0, alloc = 0;
+  int len;
+
+  for (;;) {
+    if (size == alloc) {
+      alloc = alloc ? alloc * 2 : 65536;
+      if (! (tmp = realloc(buf, alloc))) {
+        free(buf);
+        errno = ENOMEM;
+        return -1;
+      }
+      buf = tmp;
+    }
+
+    if ((len = read(fd, buf + size, (unsigned int)(alloc - size))) == -1) {
+      if (errno == EINTR)
+        continue;
+      free(buf);
+      return -1;
+    }
+
+    if (len == 0)
+      break;
+    size += len;
+  }
+
+  ocf->map = buf;
+  ocf->mapSize = size;
+  ocf->mapKind = OCF_MAP_OWNED;
+
+  return 0;
+}
+
+// Maps the archive and opens it through a libzip buffer source, so every
+// entry read is served from the page cache without read syscalls
+struct zip *_ocf_open_mapped(struct ocf *ocf, const char *filename) {
+#ifdef _WIN32
+  _epub_print_debug(ocf->epub, DEBUG_WARNING, 
+                    "mapping is not supported on this platform");
+  ocf->epub->flags &= ~EPUB_OPEN_MMAP;
+  return _ocf_open(ocf, filename);
+#else
+  int fd, ret;
+
+  if ((fd = open(filename, O_RDONLY)) == -1) {
+    _epub_print_debug(ocf->epub, DEBUG_ERROR, "%s - %s", 
+                      filename, strerror(errno));
+    return NULL;
+  }
+
+  ret = _ocf_map_fd(ocf, fd);
+  close(fd);
+  if (ret == -1) {
+    _epub_print_debug(ocf->epub, DEBUG_ERROR, "%s - %s", filename,
+                      errno == EINVAL ? "can't be mapped" : strerror(errno));
+    return NULL;
+  }
+
+  return _ocf_open_map(ocf, filename);
+#endif
+}
+
+// Opens a second handle on the archive for readers running on other 
+// threads, libzip handles are not thread safe. Close it with zip_discard.
+struct zip *_ocf_open_clone(struct ocf *ocf) {
+  struct zip *arch;
+  zip_error_t error;
+  int err;
+
+  if (! ocf->map)
+    return zip_open(ocf->filename, ZIP_RDONLY, &err);
+
+  zip_error_init(&error);
+  arch = _ocf_open_buffer(ocf->map, ocf->mapSize, &error);
+  zip_error_fini(&error);
+
+  return arch;
+}
+
+// Tells the kernel how the mapping is going to be read
+void _ocf_advise(struct ocf *ocf, enum ocf_access access) {
+#ifndef _WIN32
+  int advice = MADV_RANDOM;
+
+  // only mappings of the file benefit from readahead hints
+  if (! ocf->map || ocf->mapKind != OCF_MAP_FILE)
+    return;
+
+  if (access == OCF_ACCESS_SEQUENTIAL)
+    advice = MADV_SEQUENTIAL;
+
+  if (madvise(ocf->map, ocf->mapSize, advice) == -1)
+    _epub_print_debug(ocf->epub, DEBUG_INFO, "madvise failed - %s", 
+                      strerror(errno));
+#else
+  (void)ocf;
+  (void)access;
+#endif
+}
+
 void _ocf_close(struct ocf *ocf) {
 
+  _ocf_cache_close(ocf);
+  _ocf_range_close(ocf);
+
   if (ocf->arch) {
     if (zip_close(ocf->arch) == -1) {
       _epub_print_debug(ocf->epub, DEBUG_ERROR, "%s - %s\n", 
-                        ocf->filename, zip_strerror(ocf->arch));
+                        _ocf_name(ocf), zip_strerror(ocf->arch));
     }
   }
-  
-  FreeList(ocf->roots, (ListFreeFunc)_list_free_root);
 
+  // libzip reads from the mapping until the archive is closed
+  if (ocf->map && ocf->mapKind == OCF_MAP_OWNED)
+    free(ocf->map);
+#ifndef _WIN32
+  if (ocf->map && ocf->mapKind == OCF_MAP_FILE)
+    munmap(ocf->map, ocf->mapSize);
+#endif
+  
+  if (ocf->raw)
+    free(ocf->raw);
   if (ocf->filename)
     free(ocf->filename);
   if (ocf->mimetype)
     free(ocf->mimetype);
-  if (ocf->datapath)
-    free(ocf->datapath);
   free(ocf);
   
 }
@@ -141,59 +335,163 @@ int _ocf_check_file(struct ocf *ocf, const char *filename) {
 // Get the file named filename from epub zip and pub it in fileStr
 // Returns the size of the file or -1 on failure
 int _ocf_get_file(struct ocf *ocf, const char *filename, char **fileStr) {
+  zip_int64_t index;
+
+  *fileStr = NULL;
+
+  if ((index = zip_name_locate(ocf->arch, filename, 0)) == -1) {
+    _epub_print_debug(ocf->epub, DEBUG_INFO, "%s - %s", 
+                      filename, zip_strerror(ocf->arch));
+    return -1;
+  }
+
+  return _ocf_get_file_index(ocf, index, fileStr);
+}
+
+// Get the file at index from epub zip and pub it in fileStr
+// Returns the size of the file or -1 on failure
+int _ocf_get_file_index(struct ocf *ocf, zip_int64_t index, char **fileStr) {
+  
+  struct epub *epub = ocf->epub;
+  struct zip *arch = ocf->arch;
+
+  int size;
+
+  // entries of mapped archives are inflated straight from the mapping
+  _ocf_map_directory(ocf);
+  if ((size = _ocf_decompress(ocf, index, fileStr)) == -1 &&
+      (size = _ocf_stream_index(ocf, index, fileStr)) == -1) {
+    return -1;
+  }
+  
+  if (epub->debug >= DEBUG_VERBOSE) {
+    _epub_print_debug(epub, DEBUG_VERBOSE, "--------- Begin %s", 
+                      zip_get_name(arch, index, 0));
+    fprintf(stderr, "%s\n", (*fileStr));
+    _epub_print_debug(epub, DEBUG_VERBOSE, "--------- End %s", 
+                      zip_get_name(arch, index, 0));
+  }
+  return size;
+}
+
+// Reads the file at index through libzip into fileStr
+// Returns the size of the file or -1 on failure
+int _ocf_stream_index(struct ocf *ocf, zip_int64_t index, char **fileStr) {
   
   struct epub *epub = ocf->epub;
   struct zip *arch = ocf->arch;
   
   struct zip_file *file = NULL;
-  struct zip_stat fileStat;
+  zip_uint64_t fileSize;
 
   int size;
 
-  zip_stat_init(&fileStat);
   *fileStr = NULL;
 
-  if (zip_stat(arch, filename, ZIP_FL_UNCHANGED, &fileStat) == -1) {
-    _epub_print_debug(epub, DEBUG_INFO, "%s - %s", 
-                      filename, zip_strerror(arch));
-    return -1;
-  }
-
-  if (! (file = zip_fopen_index(arch, fileStat.index, ZIP_FL_NODIR))) {
-    _epub_print_debug(epub, DEBUG_INFO, "%s - %s", 
-                      filename, zip_strerror(arch));
+  if (! (file = _ocf_open_index(ocf, index, &fileSize))) {
     return -1;
   }
 
-  *fileStr = (char *)malloc((fileStat.size+1)* sizeof(char));
-  if (! fileStr) {
+  *fileStr = (char *)malloc((fileSize+1)* sizeof(char));
+  if (! *fileStr) {
 	  _epub_print_debug(epub, DEBUG_ERROR, "Failed to allocate memory for file string");
+	  zip_fclose(file);
 	  return -1;
   }
   
-  if ((size = zip_fread(file, *fileStr, fileStat.size)) == -1) {
+  if ((size = zip_fread(file, *fileStr, fileSize)) == -1) {
     _epub_print_debug(epub, DEBUG_INFO, "%s - %s", 
-                      filename, zip_strerror(arch));
+                      zip_get_name(arch, index, 0), zip_strerror(arch));
   } else {
     (*fileStr)[size] = 0;
   }
 
   if (zip_fclose(file) == -1) {
     _epub_print_debug(epub, DEBUG_INFO, "%s - %s", 
-                      filename, zip_strerror(arch));
+                      zip_get_name(arch, index, 0), zip_strerror(arch));
     free(*fileStr);
     *fileStr = NULL;
     return -1;
   }
-  
-  if (epub->debug >= DEBUG_VERBOSE) {
-    _epub_print_debug(epub, DEBUG_VERBOSE, "--------- Begin %s", filename);
-    fprintf(stderr, "%s\n", (*fileStr));
-    _epub_print_debug(epub, DEBUG_VERBOSE, "--------- End %s", filename);
-  }
+
   return size;
 }
 
+// Reads the whole entry at index of arch, a handle on the ocf archive,
+// into a null terminated buffer. Doesn't touch the epub so it can be used
+// from worker threads. Returns the size of the entry or -1 on failure
+int _ocf_read_entry(struct ocf *ocf, struct zip *arch, zip_int64_t index, 
+                    char **fileStr) {
+  struct zip_file *file;
+  struct zip_stat fileStat;
+  zip_int64_t size;
+
+  if ((size = _ocf_decompress(ocf, index, fileStr)) != -1)
+    return (int)size;
+
+  zip_stat_init(&fileStat);
+  if (zip_stat_index(arch, index, ZIP_FL_UNCHANGED, &fileStat) == -1)
+    return -1;
+
+  if (! (file = zip_fopen_index(arch, index, ZIP_FL_NODIR)))
+    return -1;
+
+  if (! (*fileStr = malloc(fileStat.size + 1))) {
+    zip_fclose(file);
+    return -1;
+  }
+
+  size = zip_fread(file, *fileStr, fileStat.size);
+  if (zip_fclose(file) == -1 || size == -1) {
+    free(*fileStr);
+    *fileStr = NULL;
+    return -1;
+  }
+  (*fileStr)[size] = 0;
+
+  return (int)size;
+}
+
+// Opens the file named filename for reading and stores its uncompressed
+// size in size. Returns NULL on failure
+struct zip_file *_ocf_open_file(struct ocf *ocf, const char *filename, 
+                                zip_uint64_t *size) {
+  zip_int64_t index;
+
+  if ((index = zip_name_locate(ocf->arch, filename, 0)) == -1) {
+    _epub_print_debug(ocf->epub, DEBUG_INFO, "%s - %s", 
+                      filename, zip_strerror(ocf->arch));
+    return NULL;
+  }
+
+  return _ocf_open_index(ocf, index, size);
+}
+
+// Opens the file at index for reading and stores its uncompressed size in
+// size. Returns NULL on failure
+struct zip_file *_ocf_open_index(struct ocf *ocf, zip_int64_t index, 
+                                 zip_uint64_t *size) {
+  struct zip *arch = ocf->arch;
+  struct zip_file *file = NULL;
+  struct zip_stat fileStat;
+
+  zip_stat_init(&fileStat);
+
+  if (zip_stat_index(arch, index, ZIP_FL_UNCHANGED, &fileStat) == -1) {
+    _epub_print_debug(ocf->epub, DEBUG_INFO, "entry %ld - %s", 
+                      (long)index, zip_strerror(arch));
+    return NULL;
+  }
+
+  if (! (file = zip_fopen_index(arch, index, ZIP_FL_NODIR))) {
+    _epub_print_debug(ocf->epub, DEBUG_INFO, "%s - %s", 
+                      fileStat.name, zip_strerror(arch));
+    return NULL;
+  }
+
+  *size = fileStat.size;
+  return file;
+}
 
 void _ocf_not_supported(struct ocf *ocf, const char *filename) {
   if (_ocf_check_file(ocf, filename) > -1) 
@@ -201,7 +499,7 @@ void _ocf_not_supported(struct ocf *ocf, const char *filename) {
                       "file %s exists but is not supported by this version", filename);
 }
 
-struct ocf *_ocf_parse(struct epub *epub, const char *filename) {
+struct ocf *_ocf_new(struct epub *epub) {
   struct ocf *ocf;
 
   _epub_print_debug(epub, DEBUG_INFO, "building ocf struct");
@@ -213,23 +511,19 @@ struct ocf *_ocf_parse(struct epub *epub, const char *filename) {
   }
   memset(ocf, 0, sizeof(struct ocf));
   ocf->epub = epub;
-  ocf->roots = NewListAlloc(LIST, NULL, NULL, 
-                            (NodeCompareFunc)_list_cmp_root_by_mediatype);
-  ocf->filename = malloc(sizeof(char)*(strlen(filename)+1));
-
-  if ( ! ocf->filename) {
-	  _epub_print_debug(epub, DEBUG_ERROR, "Failed to allocate memory for filename");
-	  _ocf_close(ocf);
-	  return NULL;
+  ocf->roots = _list_new(epub, (NodeCompareFunc)_list_cmp_root_by_mediatype);
+  if (!ocf->roots) {
+    _epub_err_set_oom(&epub->error);
+    free(ocf);
+    return NULL;
   }
 
-  strcpy(ocf->filename, filename);
-  
-  if (! (ocf->arch = _ocf_open(ocf, ocf->filename))) {
-	  _ocf_close(ocf);
-	  return NULL;
-  }
-  
+  return ocf;
+}
+
+// Reads the ocf files of the opened archive. Closes ocf on failure
+struct ocf *_ocf_parse_archive(struct ocf *ocf) {
+
   // Find the mime type
   if (_ocf_parse_mimetype(ocf) == -1) {
 	  _ocf_close(ocf);
@@ -239,6 +533,9 @@ struct ocf *_ocf_parse(struct epub *epub, const char *filename) {
   // Parse the container for roots
   _ocf_parse_container(ocf);
   
+  if (ocf->epub->flags & EPUB_OPEN_METADATA_ONLY)
+    return ocf;
+
   // Unsupported files
    _ocf_not_supported(ocf, METAINFO_DIR "/" MANIFEST_FILENAME);
    _ocf_not_supported(ocf, METAINFO_DIR "/" METADATA_FILENAME);
@@ -249,33 +546,264 @@ struct ocf *_ocf_parse(struct epub *epub, const char *filename) {
   return ocf;
 }
 
-int _ocf_get_data_file(struct ocf *ocf, const char *filename, char **fileStr) {
-  int size;
+struct ocf *_ocf_parse(struct epub *epub, const char *filename) {
+  struct ocf *ocf;
+
+  if (! (ocf = _ocf_new(epub)))
+    return NULL;
+
+  ocf->filename = malloc(sizeof(char)*(strlen(filename)+1));
+
+  if ( ! ocf->filename) {
+	  _epub_print_debug(epub, DEBUG_ERROR, "Failed to allocate memory for filename");
+	  _ocf_close(ocf);
+	  return NULL;
+  }
+
+  strcpy(ocf->filename, filename);
+  
+  if (! (ocf->arch = _ocf_open(ocf, ocf->filename))) {
+	  _ocf_close(ocf);
+	  return NULL;
+  }
+  
+  return _ocf_parse_archive(ocf);
+}
+
+// Like _ocf_parse for an archive in memory. With own the buffer is 
+// free()d on close (or right away on failure).
+struct ocf *_ocf_parse_memory(struct epub *epub, const void *buf, 
+                              size_t size, int own) {
+  struct ocf *ocf;
+
+  if (! (ocf = _ocf_new(epub))) {
+    if (own)
+      free((void *)buf);
+    return NULL;
+  }
+
+  ocf->map = (void *)buf;
+  ocf->mapSize = size;
+  ocf->mapKind = own ? OCF_MAP_OWNED : OCF_MAP_BORROWED;
+
+  if (! (ocf->arch = _ocf_open_map(ocf, _ocf_name(ocf)))) {
+	  _ocf_close(ocf);
+	  return NULL;
+  }
+
+  return _ocf_parse_archive(ocf);
+}
+
+// Like _ocf_parse for an open file. Regular files are mapped, anything
+// else (pipes, sockets) is read into memory since libzip needs to seek.
+struct ocf *_ocf_parse_fd(struct epub *epub, int fd) {
+  struct ocf *ocf;
+
+  if (! (ocf = _ocf_new(epub)))
+    return NULL;
+
+  if (_ocf_map_fd(ocf, fd) == -1 && 
+      (errno != EINVAL || _ocf_read_fd(ocf, fd) == -1)) {
+    _epub_print_debug(epub, DEBUG_ERROR, "fd %d - %s", fd, strerror(errno));
+    _ocf_close(ocf);
+    return NULL;
+  }
+
+  if (! (ocf->arch = _ocf_open_map(ocf, _ocf_name(ocf)))) {
+	  _ocf_close(ocf);
+	  return NULL;
+  }
+
+  return _ocf_parse_archive(ocf);
+}
+
+// Returns the canonical archive name of a file in the data directory
+// The result should be free()d
+char *_ocf_data_name(struct ocf *ocf, const char *filename) {
   char *fullname;
   char *canon_name;
 
   if (! filename) {
-	  return -1;
+	  return NULL;
   }
 
   fullname = malloc((strlen(filename)+strlen(ocf->datapath)+1)*sizeof(char));
 
   if (!fullname) {
 	  _epub_print_debug(ocf->epub, DEBUG_ERROR, "Failed to allocate memory for file name");
-	  return -1;
+	  return NULL;
   }
 
   strcpy(fullname, ocf->datapath);
   strcat(fullname, filename);
   canon_name = canonicalize_filename(fullname);
+  free(fullname);
+
+  return canon_name;
+}
+
+int _ocf_get_data_file(struct ocf *ocf, const char *filename, char **fileStr) {
+  int size;
+  char *canon_name;
+
+  if (! (canon_name = _ocf_data_name(ocf, filename))) {
+	  return -1;
+  }
 
   size = _ocf_get_file(ocf, canon_name, fileStr);
-  free(fullname);
   free(canon_name);
 
   return size;
 }
 
+#define ZIP_EOCD_SIGNATURE 0x06054b50
+#define ZIP_CDIR_SIGNATURE 0x02014b50
+#define ZIP_LOCAL_SIGNATURE 0x04034b50
+#define ZIP_EOCD_SIZE 22
+#define ZIP_CDIR_SIZE 46
+#define ZIP_LOCAL_SIZE 30
+
+zip_uint16_t _ocf_le16(const unsigned char *p) {
+  return (zip_uint16_t)(p[0] | (p[1] << 8));
+}
+
+zip_uint32_t _ocf_le32(const unsigned char *p) {
+  return (zip_uint32_t)p[0] | ((zip_uint32_t)p[1] << 8) |
+    ((zip_uint32_t)p[2] << 16) | ((zip_uint32_t)p[3] << 24);
+}
+
+// Reads the central directory of a mapped archive so entries can be
+// located in the mapping. Returns 1 if the directory is available.
+int _ocf_map_directory(struct ocf *ocf) {
+  const unsigned char *map = ocf->map;
+  size_t pos, end;
+  zip_int64_t i, count;
+
+  if (ocf->rawCount != 0)
+    return ocf->rawCount > 0;
+  ocf->rawCount = -1;
+
+  if (! map || ocf->mapSize < ZIP_EOCD_SIZE)
+    return 0;
+
+  // the end of central directory record is followed by a comment of up
+  // to 64k
+  pos = ocf->mapSize - ZIP_EOCD_SIZE;
+  while (_ocf_le32(map + pos) != ZIP_EOCD_SIGNATURE) {
+    if (pos == 0 || ocf->mapSize - pos > ZIP_EOCD_SIZE + 0xffff)
+      return 0;
+    pos--;
+  }
+
+  count = _ocf_le16(map + pos + 10);
+  end = pos;
+  pos = _ocf_le32(map + pos + 16);
+
+  // zip64 archives are left to libzip
+  if (count == 0xffff || pos == 0xffffffff || 
+      count != zip_get_num_entries(ocf->arch, ZIP_FL_UNCHANGED))
+    return 0;
+
+  ocf->raw = malloc((count ? count : 1) * sizeof(struct ocf_rawentry));
+  if (! ocf->raw) {
+    _epub_err_set_oom(&ocf->epub->error);
+    return 0;
+  }
+
+  for (i = 0; i < count; i++) {
+    struct ocf_rawentry *entry = &ocf->raw[i];
+    const unsigned char *rec = map + pos;
+
+    if (pos + ZIP_CDIR_SIZE > end || _ocf_le32(rec) != ZIP_CDIR_SIGNATURE) {
+      _epub_print_debug(ocf->epub, DEBUG_INFO, 
+                        "inconsistent central directory, not mapping entries");
+      free(ocf->raw);
+      ocf->raw = NULL;
+      return 0;
+    }
+
+    entry->flags = _ocf_le16(rec + 8);
+    entry->method = _ocf_le16(rec + 10);
+    entry->compSize = _ocf_le32(rec + 20);
+    entry->size = _ocf_le32(rec + 24);
+    entry->offset = _ocf_le32(rec + 42);
+    entry->crc = _ocf_le32(rec + 16);
+    // encrypted and zip64 entries go through libzip
+    entry->direct = ! (entry->flags & 1) &&
+      entry->compSize != 0xffffffff && entry->size != 0xffffffff &&
+      entry->offset != 0xffffffff;
+
+    pos += ZIP_CDIR_SIZE + _ocf_le16(rec + 28) + _ocf_le16(rec + 30) + 
+      _ocf_le16(rec + 32);
+  }
+
+  ocf->rawCount = count;
+  return 1;
+}
+
+// Returns a pointer to the (possibly compressed) data of the entry in
+// the mapping or NULL if it can't be read directly. Once the directory
+// is mapped this doesn't modify ocf, so workers can call it too.
+const char *_ocf_raw_data(struct ocf *ocf, zip_int64_t index) {
+  struct ocf_rawentry *entry;
+  const unsigned char *local;
+  zip_uint64_t dataOffset;
+
+  if (! _ocf_map_directory(ocf) || index < 0 || index >= ocf->rawCount)
+    return NULL;
+
+  entry = &ocf->raw[index];
+  if (! entry->direct || entry->offset + ZIP_LOCAL_SIZE > ocf->mapSize)
+    return NULL;
+
+  local = (const unsigned char *)ocf->map + entry->offset;
+  dataOffset = entry->offset + ZIP_LOCAL_SIZE + 
+    _ocf_le16(local + 26) + _ocf_le16(local + 28);
+
+  if (_ocf_le32(local) != ZIP_LOCAL_SIGNATURE ||
+      dataOffset + entry->compSize > ocf->mapSize)
+    return NULL;
+
+  return (const char *)ocf->map + dataOffset;
+}
+
+// Fills view with the entry named filename. Stored entries of mapped 
+// archives are borrowed, anything else holds a reference to a blob.
+// Stored entries whose sizes disagree go through the blob too, where
+// they are checked, since only compSize bytes are known to be mapped.
+// Returns the size of the entry or -1 on failure
+int _ocf_get_view(struct ocf *ocf, const char *filename, struct epub_view *view) {
+  zip_int64_t index;
+  const char *data;
+  struct ocf_blob *blob;
+
+  view->data = NULL;
+  view->size = 0;
+  view->owned = NULL;
+
+  if ((index = _ocf_check_file(ocf, filename)) == -1) {
+    _epub_print_debug(ocf->epub, DEBUG_INFO, "%s - %s", 
+                      filename, zip_strerror(ocf->arch));
+    return -1;
+  }
+
+  if ((data = _ocf_raw_data(ocf, index)) && 
+      ocf->raw[index].method == ZIP_CM_STORE &&
+      ocf->raw[index].compSize == ocf->raw[index].size) {
+    view->data = data;
+    view->size = ocf->raw[index].size;
+    return view->size;
+  }
+
+  if (! (blob = _ocf_blob_get(ocf, index)))
+    return -1;
+
+  view->data = blob->data;
+  view->size = blob->size;
+  view->owned = blob;
+  return view->size;
+}
+
 char *_ocf_root_fullpath_by_type(struct ocf *ocf, const char *type) {
   struct root look = {(xmlChar *)type, NULL};
   struct root *res;
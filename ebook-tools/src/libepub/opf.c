@@ -1,139 +1,348 @@
 #include "epublib.h"
 #include "url.h"
 
+// Reads the package through the text reader. Returns -1 on failure
+int _opf_read_package(struct opf *opf, char *opfStr) {
+  struct epub *epub = opf->epub;
+  xmlTextReaderPtr reader;
+  int ret;
+
+  reader = xmlReaderForMemory(opfStr, strlen(opfStr), 
+                              "OPF", NULL, 0);
+  if (reader == NULL) {
+    _epub_print_debug(epub, DEBUG_ERROR, "unable to open OPF");
+    return -1;
+  }
+
+  ret = xmlTextReaderRead(reader);
+  while (ret == 1) {
+    const xmlChar *name = xmlTextReaderConstLocalName(reader);
+    if (xmlStrcmp(name, (xmlChar *)"metadata") == 0) {
+      _opf_parse_metadata(opf, reader);
+      // the rest of the package isn't needed
+      if (epub->flags & EPUB_OPEN_METADATA_ONLY) {
+        ret = 0;
+        break;
+      }
+    } else 
+    if (xmlStrcmp(name, (xmlChar *)"manifest") == 0)
+      _opf_parse_manifest(opf, reader);
+    else 
+    if (xmlStrcmp(name, (xmlChar *)"spine") == 0)
+      _opf_parse_spine(opf, reader);
+    else 
+    if (xmlStrcmp(name, (xmlChar *)"guide") == 0)
+      _opf_parse_guide(opf, reader);
+    else 
+    if (xmlStrcmp(name, (xmlChar *)"tours") == 0)
+      _opf_parse_tours(opf, reader);
+      
+    ret = xmlTextReaderRead(reader);
+  }
+
+  xmlFreeTextReader(reader);
+  if (ret != 0) {
+    _epub_print_debug(epub, DEBUG_ERROR, "failed to parse OPF");
+    return -1;
+  }
+
+  return 0;
+}
+
 struct opf *_opf_parse(struct epub *epub, char *opfStr) {
   struct opf *opf;
-  xmlTextReaderPtr reader;
   int ret;
 
   _epub_print_debug(epub, DEBUG_INFO, "building opf struct");
   
-  opf = malloc(sizeof(struct opf));
+  opf = arena_zalloc(epub->arena, sizeof(struct opf));
   if (!opf) {
     _epub_err_set_oom(&epub->error);
     return NULL;
   }
-  memset(opf, 0, sizeof(struct opf));
   opf->epub = epub;
-  
-  reader = xmlReaderForMemory(opfStr, strlen(opfStr), 
-                              "OPF", NULL, 0);
-   if (reader != NULL) {
-    ret = xmlTextReaderRead(reader);
-    while (ret == 1) {
-      const xmlChar *name = xmlTextReaderConstLocalName(reader);
-      if (xmlStrcmp(name, (xmlChar *)"metadata") == 0)
-        _opf_parse_metadata(opf, reader);
-      else 
-      if (xmlStrcmp(name, (xmlChar *)"manifest") == 0)
-        _opf_parse_manifest(opf, reader);
-      else 
-      if (xmlStrcmp(name, (xmlChar *)"spine") == 0)
-        _opf_parse_spine(opf, reader);
-      else 
-      if (xmlStrcmp(name, (xmlChar *)"guide") == 0)
-        _opf_parse_guide(opf, reader);
-      else 
-      if (xmlStrcmp(name, (xmlChar *)"tours") == 0)
-        _opf_parse_tours(opf, reader);
-      
-     ret = xmlTextReaderRead(reader);
-    }
 
-    xmlFreeTextReader(reader);
-    if (ret != 0) {
-      _epub_print_debug(opf->epub, DEBUG_ERROR, "failed to parse OPF");
-      _opf_close(opf);
-      return NULL;
-    } else if(!opf->spine) {
-		_epub_print_debug(opf->epub, DEBUG_ERROR, "Ilegal OPF no spine found");
-		_opf_close(opf);
-		return NULL;
-	}
-   } else {
-     _epub_print_debug(opf->epub, DEBUG_ERROR, "unable to open OPF");
-     _opf_close(opf);
-     return NULL;
-   }
+  if (epub->flags & EPUB_OPEN_SAX)
+    ret = _opf_sax_package(opf, opfStr, strlen(opfStr));
+  else
+    ret = _opf_read_package(opf, opfStr);
+
+  if (ret == -1) {
+    _opf_close(opf);
+    return NULL;
+  } else if(!opf->spine && !(epub->flags & EPUB_OPEN_METADATA_ONLY)) {
+    _epub_print_debug(opf->epub, DEBUG_ERROR, "Ilegal OPF no spine found");
+    _opf_close(opf);
+    return NULL;
+  }
+
+  if (_opf_index_spine(opf) == -1) {
+    _opf_close(opf);
+    return NULL;
+  }
+
+  // the toc worker is done by now, or the toc is parsed here
+  if (epub->flags & EPUB_OPEN_TOC)
+    _opf_toc_join(opf);
+
+  return opf;
+}
+
+// Builds the iterator orders, resolves the manifest item of every spine 
+// item and stores in every manifest item its first position in the spine
+int _opf_index_spine(struct opf *opf) {
+  struct spine_order *orders = opf->spineOrders;
+  struct spine *item;
+  int pos, type;
+
+  if (! opf->spine)
+    return 0;
+
+  for (type = 0; type < EITERATOR_TYPES; type++)
+    orders[type].positions = arena_alloc(opf->epub->arena,
+                                         (opf->spine->count + 1) * sizeof(int));
+
+  if (! orders[EITERATOR_SPINE].positions ||
+      ! orders[EITERATOR_LINEAR].positions ||
+      ! orders[EITERATOR_NONLINEAR].positions) {
+    _epub_err_set_oom(&opf->epub->error);
+    return -1;
+  }
+
+  for (pos = 0; pos < opf->spine->count; pos++) {
+    item = &opf->spine->items[pos];
+
+    item->item = _opf_manifest_get_by_id(opf, item->idref);
+    if (item->item && item->item->spineIndex == -1)
+      item->item->spineIndex = pos;
+
+    // the position an iterator of every type seeks to from here
+    for (type = 0; type < EITERATOR_TYPES; type++)
+      item->orderPos[type] = orders[type].count;
 
-   return opf;
+    orders[EITERATOR_SPINE].positions[orders[EITERATOR_SPINE].count++] = pos;
+    type = item->linear ? EITERATOR_LINEAR : EITERATOR_NONLINEAR;
+    orders[type].positions[orders[type].count++] = pos;
+  }
+
+  return 0;
 }
 
-xmlChar *_get_possible_namespace(xmlTextReaderPtr reader, 
+// Element names hash to their length, first and last letter, which no two
+// of OPF_ELEMENTS share (a collision doesn't compile)
+#define OPF_ELEMENT_KEY(len, first, last) \
+  (((len) << 16) | ((first) << 8) | (last))
+#define OPF_ELEMENT_CASE(id, name, len, first, last) \
+  case OPF_ELEMENT_KEY(len, first, last): \
+    element = OPF_ELEMENT_##id; \
+    str = name; \
+    break;
+
+static int _opf_lower(int c) {
+  return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+// Returns which of OPF_ELEMENTS name is (case is ignored), with a single
+// string comparison
+enum opf_element _opf_element(const xmlChar *name) {
+  enum opf_element element;
+  const char *str;
+  int len = xmlStrlen(name);
+
+  if (! len)
+    return OPF_ELEMENT_OTHER;
+
+  switch (OPF_ELEMENT_KEY(len, _opf_lower(name[0]), 
+                          _opf_lower(name[len - 1]))) {
+  OPF_ELEMENTS(OPF_ELEMENT_CASE)
+  default:
+    return OPF_ELEMENT_OTHER;
+  }
+
+  return xmlStrcasecmp(name, (xmlChar *)str) ? OPF_ELEMENT_OTHER : element;
+}
+
+xmlChar *_get_possible_namespace(struct opf *opf, xmlTextReaderPtr reader, 
                                  const xmlChar * localName, 
                                  const xmlChar * namespace) 
 {
-  xmlChar *tmp, *ns;
+  xmlChar *tmp = NULL, *ns;
   ns = xmlTextReaderLookupNamespace(reader, namespace);
-  tmp = xmlTextReaderGetAttributeNs(reader, localName, ns);
+  if (ns && xmlTextReaderMoveToAttributeNs(reader, localName, ns) == 1) {
+    tmp = (xmlChar *)strpool_strdup(opf->epub->strings, 
+                                    (char *)xmlTextReaderConstValue(reader));
+    xmlTextReaderMoveToElement(reader);
+  }
 
   if (ns)
     free(ns);
   
   if (! tmp)
-    return xmlTextReaderGetAttribute(reader, localName);
+    return _epub_xml_attribute(opf->epub, reader, (char *)localName);
   
   return tmp;
 }
 
 void _opf_init_metadata(struct opf *opf) {
-  struct metadata *meta = malloc(sizeof(struct metadata));
-
-  meta->id = NewListAlloc(LIST, NULL, NULL, NULL);  
-  meta->title = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->creator = NewListAlloc(LIST, NULL, NULL, NULL);
-  meta->contrib = NewListAlloc(LIST, NULL, NULL, NULL);
-  meta->subject = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->publisher = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->description = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->date = NewListAlloc(LIST, NULL, NULL, NULL);
-  meta->type = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->format = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->source = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->lang = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->relation = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->coverage = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->rights = NewListAlloc(LIST, NULL, NULL, (NodeCompareFunc)StringCompare);
-  meta->meta = NewListAlloc(LIST, NULL, NULL, NULL);
-
-  opf->metadata = meta;
-}
-
-void _opf_free_metadata(struct metadata *meta) {
-  FreeList(meta->id, (ListFreeFunc)_list_free_id);
-  FreeList(meta->title, free);
-  FreeList(meta->creator, (ListFreeFunc)_list_free_creator);
-  FreeList(meta->contrib, (ListFreeFunc)_list_free_creator);
-  FreeList(meta->subject, free);
-  FreeList(meta->publisher, free);
-  FreeList(meta->description, free);
-  FreeList(meta->date, (ListFreeFunc)_list_free_date);
-  FreeList(meta->type, free);
-  FreeList(meta->format, free);
-  FreeList(meta->source, free);
-  FreeList(meta->lang, free);
-  FreeList(meta->relation, free);
-  FreeList(meta->coverage, free);
-  FreeList(meta->rights, free);
-  FreeList(meta->meta, (ListFreeFunc)_list_free_meta);
-  free(meta);
+  // all the categories start empty
+  opf->metadata = arena_zalloc(opf->epub->arena, sizeof(struct metadata));
+  if (! opf->metadata)
+    _epub_err_set_oom(&opf->epub->error);
+}
+
+// Adds a metadata element to the metadata. string is its text, values
+// its attributes, which are by element:
+//   identifier: scheme, id
+//   creator, contributor: file-as, role
+//   meta: name, content, property
+//   date: event
+void _opf_add_metadata(struct opf *opf, enum opf_element element,
+                       const xmlChar *localName, xmlChar *string,
+                       xmlChar **values) {
+  struct metadata *meta = opf->metadata;
+
+  if (! meta)
+    return;
+
+  switch (element) {
+  case OPF_ELEMENT_IDENTIFIER: {
+    struct id new;
+    new.string = string;
+    new.scheme = values[0];
+    new.id = values[1];
+      
+    VECTOR_ADD(opf->epub, meta->id, new);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "identifier %s(%s) is: %s", 
+                      new.id, new.scheme, new.string);
+    break;
+  }
+  case OPF_ELEMENT_TITLE:
+    VECTOR_ADD(opf->epub, meta->title, string);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "title is %s", string);
+    break;
+        
+  case OPF_ELEMENT_CREATOR:
+  case OPF_ELEMENT_CONTRIBUTOR: {
+    struct creator new;
+    new.name = string;
+    new.fileAs = values[0];
+    new.role = values[1];
+    if (element == OPF_ELEMENT_CREATOR) {
+      VECTOR_ADD(opf->epub, meta->creator, new);
+      _epub_print_debug(opf->epub, DEBUG_INFO, "creator - %s: %s (%s)", 
+                        new.role, new.name, new.fileAs);
+    } else {
+      VECTOR_ADD(opf->epub, meta->contrib, new);
+      _epub_print_debug(opf->epub, DEBUG_INFO, "contributor - %s: %s (%s)", 
+                        new.role, new.name, new.fileAs);
+    }
+    break;
+  }
+  case OPF_ELEMENT_META: {
+    struct meta new;
+    new.name = values[0];
+    new.content = values[1];
+    new.property = values[2];
+    new.value = string;
+      
+    VECTOR_ADD(opf->epub, meta->meta, new);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "meta is %s: %s", 
+                      new.name, new.content); 
+    if (new.property) {
+      _epub_print_debug(opf->epub, DEBUG_INFO, "meta has property %s: %s", 
+                        new.property, new.value); 
+    }
+    break;
+  }
+  case OPF_ELEMENT_DATE: {
+    struct date new;
+    new.date = string;
+    new.event = values[0];
+    VECTOR_ADD(opf->epub, meta->date, new);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "date of %s: %s", 
+                      new.event, new.date); 
+    break;
+  }
+  case OPF_ELEMENT_SUBJECT:
+    VECTOR_ADD(opf->epub, meta->subject, string);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "subject is %s", string);
+    break;
+        
+  case OPF_ELEMENT_PUBLISHER:
+    VECTOR_ADD(opf->epub, meta->publisher, string); 
+    _epub_print_debug(opf->epub, DEBUG_INFO, "publisher is %s", string); 
+    break;
+        
+  case OPF_ELEMENT_DESCRIPTION:
+    VECTOR_ADD(opf->epub, meta->description, string);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "description is %s", string);
+    break;
+        
+  case OPF_ELEMENT_TYPE:
+    VECTOR_ADD(opf->epub, meta->type, string);       
+    _epub_print_debug(opf->epub, DEBUG_INFO, "type is %s", string);
+    break;
+        
+  case OPF_ELEMENT_FORMAT:
+    VECTOR_ADD(opf->epub, meta->format, string);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "format is %s", string); 
+    break;
+
+  case OPF_ELEMENT_SOURCE:
+    VECTOR_ADD(opf->epub, meta->source, string);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "source is %s", string); 
+    break;
+
+  case OPF_ELEMENT_LANGUAGE:
+    // interned like the languages of toc labels
+    string = _epub_intern(opf->epub, string);
+    VECTOR_ADD(opf->epub, meta->lang, string);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "language is %s", string); 
+    break;
+      
+  case OPF_ELEMENT_RELATION:
+    VECTOR_ADD(opf->epub, meta->relation, string);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "relation is %s", string); 
+    break;
+
+  case OPF_ELEMENT_COVERAGE:
+    VECTOR_ADD(opf->epub, meta->coverage, string);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "coverage is %s", string); 
+    break;
+
+  case OPF_ELEMENT_RIGHTS:
+    VECTOR_ADD(opf->epub, meta->rights, string);
+    _epub_print_debug(opf->epub, DEBUG_INFO, "rights is %s", string);
+    break;
+
+  case OPF_ELEMENT_DC_METADATA:
+  case OPF_ELEMENT_X_METADATA:
+    break;
+
+  default:
+    if (string)
+      _epub_print_debug(opf->epub, DEBUG_INFO, "unsupported local %s: %s", 
+                        localName, string); 
+    break;
+  }
 }
 
 void _opf_parse_metadata(struct opf *opf, xmlTextReaderPtr reader) {
   int ret;
-  struct metadata *meta;
-  const xmlChar *local;
-  xmlChar *string;
+  enum opf_element element;
+  xmlChar *string, *values[OPF_METADATA_VALUES];
   
   _epub_print_debug(opf->epub, DEBUG_INFO, "parsing metadata");
   
   // must have title, identifier and language
   _opf_init_metadata(opf);
-  meta = opf->metadata;
+  if (! opf->metadata)
+    return;
   
   ret = xmlTextReaderRead(reader);
   while (ret == 1 && 
-         xmlStrcasecmp(xmlTextReaderConstLocalName(reader),(xmlChar *)"metadata")) {
+         (element = _opf_element(xmlTextReaderConstLocalName(reader))) !=
+         OPF_ELEMENT_METADATA) {
 
     // ignore non starting tags
     if (xmlTextReaderNodeType(reader) != 1) {
@@ -141,213 +350,166 @@ void _opf_parse_metadata(struct opf *opf, xmlTextReaderPtr reader) {
       continue;
     }
     
-    local = xmlTextReaderConstLocalName(reader);
-    string = (xmlChar *)xmlTextReaderReadString(reader);
-
-    if (xmlStrcasecmp(local, (xmlChar *)"identifier") == 0) {
-      struct id *new = malloc(sizeof(struct id));
-      new->string = string;
-      new->scheme = _get_possible_namespace(reader, (xmlChar *)"scheme",
-                                                (xmlChar *)"opf");
-      new->id = xmlTextReaderGetAttribute(reader, (xmlChar *)"id");
-      
-      AddNode(meta->id, NewListNode(meta->id, new));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "identifier %s(%s) is: %s", 
-                        new->id, new->scheme, new->string);
-    } else if (xmlStrcasecmp(local, (xmlChar *)"title") == 0) {
-      AddNode(meta->title, NewListNode(meta->title, string));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "title is %s", string);
-        
-    } else if (xmlStrcasecmp(local, (xmlChar *)"creator") == 0) {
-      struct creator *new = malloc(sizeof(struct creator));
-      new->name = string;
-      new->fileAs = 
-        _get_possible_namespace(reader, (xmlChar *)"file-as",
-                                    (xmlChar *)"opf");
-      new->role = 
-        _get_possible_namespace(reader, (xmlChar *)"role",
-                                    (xmlChar *)"opf");
-      AddNode(meta->creator, NewListNode(meta->creator, new));       
-      _epub_print_debug(opf->epub, DEBUG_INFO, "creator - %s: %s (%s)", 
-                        new->role, new->name, new->fileAs);
-        
-    } else if (xmlStrcasecmp(local, (xmlChar *)"contributor") == 0) {
-      struct creator *new = malloc(sizeof(struct creator));
-      new->name = string;
-      new->fileAs = 
-        _get_possible_namespace(reader, (xmlChar *)"file-as",
-                                    (xmlChar *)"opf");
-      new->role = 
-        _get_possible_namespace(reader, (xmlChar *)"role",
-                                    (xmlChar *)"opf");
-      AddNode(meta->contrib, NewListNode(meta->contrib, new));     
-      _epub_print_debug(opf->epub, DEBUG_INFO, "contributor - %s: %s (%s)", 
-                        new->role, new->name, new->fileAs);
-      
-    } else if (xmlStrcasecmp(local, (xmlChar *)"meta") == 0) {
-      struct meta *new = malloc(sizeof(struct meta));
-      new->name = xmlTextReaderGetAttribute(reader, (xmlChar *)"name");
-      new->content = xmlTextReaderGetAttribute(reader, (xmlChar *)"content");
-      new->property = xmlTextReaderGetAttribute(reader, (xmlChar *)"property");
-      new->value = string;
-      
-      AddNode(meta->meta, NewListNode(meta->meta, new));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "meta is %s: %s", 
-                        new->name, new->content); 
-      if (new->property) {
-        _epub_print_debug(opf->epub, DEBUG_INFO, "meta has property %s: %s", 
-                        new->property, new->value); 
-      }
-    } else if (xmlStrcasecmp(local, (xmlChar *)"date") == 0) {
-      struct date *new = malloc(sizeof(struct date));
-      new->date = string;
-      new->event = _get_possible_namespace(reader, (xmlChar *)"event",
-                                               (xmlChar *)"opf");
-      AddNode(meta->date, NewListNode(meta->date, new));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "date of %s: %s", 
-                        new->event, new->date); 
-        
-    } else if (xmlStrcasecmp(local, (xmlChar *)"subject") == 0) {
-      AddNode(meta->subject, NewListNode(meta->subject, string));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "subject is %s", string);
-        
-    } else if (xmlStrcasecmp(local, (xmlChar *)"publisher") == 0) {
-      AddNode(meta->publisher, NewListNode(meta->publisher, string)); 
-      _epub_print_debug(opf->epub, DEBUG_INFO, "publisher is %s", string); 
-        
-    } else if (xmlStrcasecmp(local, (xmlChar *)"description") == 0) {
-      AddNode(meta->description, NewListNode(meta->description, string));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "description is %s", string);
-        
-    } else if (xmlStrcasecmp(local, (xmlChar *)"type") == 0) {
-      AddNode(meta->type, NewListNode(meta->type, string));       
-      _epub_print_debug(opf->epub, DEBUG_INFO, "type is %s", string);
-        
-    } else if (xmlStrcasecmp(local, (xmlChar *)"format") == 0) {
-      AddNode(meta->format, NewListNode(meta->format, string));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "format is %s", string); 
-
-    } else if (xmlStrcasecmp(local, (xmlChar *)"source") == 0) {
-      AddNode(meta->source, NewListNode(meta->source, string));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "source is %s", string); 
-
-    } else if (xmlStrcasecmp(local, (xmlChar *)"language") == 0) {
-      AddNode(meta->lang, NewListNode(meta->lang, string));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "language is %s", string); 
-      
-    } else if (xmlStrcasecmp(local, (xmlChar *)"relation") == 0) {
-      AddNode(meta->relation, NewListNode(meta->relation, string));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "relation is %s", string); 
-
-    } else if (xmlStrcasecmp(local, (xmlChar *)"coverage") == 0) {
-      AddNode(meta->coverage, NewListNode(meta->coverage, string));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "coverage is %s", string); 
-    } else if (xmlStrcasecmp(local, (xmlChar *)"rights") == 0) {
-      AddNode(meta->rights, NewListNode(meta->rights, string));
-      _epub_print_debug(opf->epub, DEBUG_INFO, "rights is %s", string);
-    } else if (string) {
-      if (xmlStrcasecmp(local, (xmlChar *)"dc-metadata") != 0 &&
-          xmlStrcasecmp(local, (xmlChar *)"x-metadata") != 0)
-        _epub_print_debug(opf->epub, DEBUG_INFO,
-                          "unsupported local %s: %s", local, string); 
-      free(string);
+    string = _epub_xml_string(opf->epub, reader);
+
+    memset(values, 0, sizeof(values));
+    switch (element) {
+    case OPF_ELEMENT_IDENTIFIER:
+      values[0] = _get_possible_namespace(opf, reader, (xmlChar *)"scheme",
+                                          (xmlChar *)"opf");
+      values[1] = _epub_xml_attribute(opf->epub, reader, "id");
+      break;
+    case OPF_ELEMENT_CREATOR:
+    case OPF_ELEMENT_CONTRIBUTOR:
+      values[0] = _get_possible_namespace(opf, reader, (xmlChar *)"file-as",
+                                          (xmlChar *)"opf");
+      values[1] = _get_possible_namespace(opf, reader, (xmlChar *)"role",
+                                          (xmlChar *)"opf");
+      break;
+    case OPF_ELEMENT_META:
+      values[0] = _epub_xml_attribute(opf->epub, reader, "name");
+      values[1] = _epub_xml_attribute(opf->epub, reader, "content");
+      values[2] = _epub_xml_attribute(opf->epub, reader, "property");
+      break;
+    case OPF_ELEMENT_DATE:
+      values[0] = _get_possible_namespace(opf, reader, (xmlChar *)"event",
+                                          (xmlChar *)"opf");
+      break;
+    default:
+      break;
     }
 
+    _opf_add_metadata(opf, element, xmlTextReaderConstLocalName(reader),
+                      string, values);
+
     ret = xmlTextReaderRead(reader);
   }
 }
 
-struct toc *_opf_init_toc() {
-  
-  struct toc *toc = malloc(sizeof(struct toc));
-  memset(toc, 0, sizeof(struct toc));
+struct toc *_opf_init_toc(struct opf *opf) {
+  struct toc *toc = arena_zalloc(opf->epub->arena, sizeof(struct toc));
 
-  toc->playOrder = NewListAlloc(LIST, NULL, NULL, 
-                                (NodeCompareFunc)_list_cmp_toc_by_playorder);
+  if (! toc)
+    _epub_err_set_oom(&opf->epub->error);
 
   return toc;
 }
 
-struct tocCategory *_opf_init_toc_category() {
-  struct tocCategory *tc = malloc(sizeof(struct tocCategory));
-  memset(tc, 0, sizeof(struct tocCategory));
+struct tocCategory *_opf_init_toc_category(struct opf *opf) {
+  struct tocCategory *tc = arena_zalloc(opf->epub->arena, 
+                                        sizeof(struct tocCategory));
 
-  tc->info = NewListAlloc(LIST, NULL, NULL, NULL); //tocLabel
-  tc->label = NewListAlloc(LIST, NULL, NULL, NULL); //tocLabel
-  tc->items = NewListAlloc(LIST, NULL, NULL, NULL); //tocItem
+  if (! tc)
+    _epub_err_set_oom(&opf->epub->error);
 
   return tc;
 }
 
-void _opf_free_toc_category(struct tocCategory *tc) {
-  if (tc->id)
-    free(tc->id);
-  if (tc->class)
-    free(tc->class);
-  
-  FreeList(tc->info, (ListFreeFunc)_list_free_toc_label);
-  FreeList(tc->label, (ListFreeFunc)_list_free_toc_label);
-  FreeList(tc->items, (ListFreeFunc)_list_free_toc_item);
-  
-  free(tc);
-}
-
-void _opf_free_toc(struct toc *toc) {
-  
-  if (toc->navMap)
-    _opf_free_toc_category(toc->navMap);
-  if (toc->navList)
-    _opf_free_toc_category(toc->navList);
-  if (toc->pageList)
-    _opf_free_toc_category(toc->pageList);
-
-  // all items are already free, lets free only the struct
-  FreeList(toc->playOrder, NULL);
-
-  free(toc);
-
-}
-
-// Parse a navLabel or navInfo returns NULL on failure and the label on success 
-struct tocLabel *_opf_parse_navlabel(struct opf *opf, xmlTextReaderPtr reader) {
+// Parse a navLabel or navInfo into new, returns -1 on failure and 0 on 
+// success
+int _opf_parse_navlabel(struct opf *opf, xmlTextReaderPtr reader,
+                        struct tocLabel *new) {
+  enum opf_element element;
   int ret;
-  
-  struct tocLabel *new = malloc(sizeof(struct tocLabel));
-  memset(new, 0, sizeof(struct tocLabel));
 
-  new->lang = xmlTextReaderGetAttribute(reader, (xmlChar *)"lang");
-  new->dir = xmlTextReaderGetAttribute(reader, (xmlChar *)"dir");
+  memset(new, 0, sizeof(struct tocLabel));
+  // xml:lang per the NCX, a plain lang if that's what the book has
+  new->lang = _epub_xml_attribute_interned(opf->epub, reader, "xml:lang");
+  if (! new->lang)
+    new->lang = _epub_xml_attribute_interned(opf->epub, reader, "lang");
+  new->dir = _epub_xml_attribute_interned(opf->epub, reader, "dir");
 
   ret = xmlTextReaderRead(reader);
   while (ret == 1 && 
-         xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navLabel") &&
-         xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navInfo")) {
-    if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"text") &&
-        xmlTextReaderNodeType(reader) == 1) {
-      new->text = (xmlChar *)xmlTextReaderReadString(reader);
+         (element = _opf_element(xmlTextReaderConstName(reader))) != 
+         OPF_ELEMENT_NAVLABEL && element != OPF_ELEMENT_NAVINFO) {
+    if (element == OPF_ELEMENT_TEXT && xmlTextReaderNodeType(reader) == 1) {
+      new->text = _epub_xml_string(opf->epub, reader);
     }
     ret = xmlTextReaderRead(reader);
   }
 
-  if (ret != 1) {
-    free(new);
-    return NULL;
-  }
+  if (ret != 1)
+    return -1;
+  return 0;
+}
+
+// Adds a parsed navLabel or navInfo to the item's labels (item may be 
+// NULL) or the labels of the category
+void _opf_add_label(struct opf *opf, struct tocCategory *tc, 
+                    struct tocItem *item, int info, struct tocLabel *label) {
+  struct toc *toc = opf->toc;
+
   _epub_print_debug(opf->epub, DEBUG_INFO, 
                     "parsing label/info %s(%s/%s)",
-                    new->text, new->lang, new->dir);
-  return new;
+                    label->text, label->lang, label->dir);
+
+  if (info) {
+    VECTOR_ADD(opf->epub, tc->info, *label);
+  } else if (item) {
+    // the labels of an item are parsed one after the other
+    if (! item->labelCount)
+      item->label = toc->labels.count;
+    if (VECTOR_ADD(opf->epub, toc->labels, *label) == 0)
+      item->labelCount++;
+  } else {
+    VECTOR_ADD(opf->epub, tc->label, *label);
+  }
 }
 
-struct tocItem *_opf_init_toc_item(int depth) {
-  struct tocItem *item = malloc(sizeof(struct tocItem));
-  memset(item, 0, sizeof(struct tocItem));
+// Adds the navLabel or navInfo at the reader, see _opf_add_label
+void _opf_add_navlabel(struct opf *opf, xmlTextReaderPtr reader,
+                       struct tocCategory *tc, struct tocItem *item,
+                       int info) {
+  struct tocLabel label;
+
+  if (_opf_parse_navlabel(opf, reader, &label) == 0)
+    _opf_add_label(opf, tc, item, info, &label);
+}
 
+void _opf_init_toc_item(struct tocItem *item, int depth) {
+  memset(item, 0, sizeof(struct tocItem));
   item->depth = depth;
   item->playOrder = -1;
   item->value = -1;
+}
 
-  return item;
+// Handles a navLabel, navInfo or content element of the toc category tc.
+// item is the item being parsed (NULL between items), named kind in
+// messages.
+void _opf_parse_toc_child(struct opf *opf, xmlTextReaderPtr reader,
+                          enum opf_element element, struct tocCategory *tc,
+                          struct tocItem *item, const char *kind) {
+  char *src;
+
+  switch (element) {
+  case OPF_ELEMENT_NAVLABEL:
+    // Not inside navpoint without item
+    _opf_add_navlabel(opf, reader, tc, item, 0);
+    break;
+
+  case OPF_ELEMENT_NAVINFO:
+    _opf_add_navlabel(opf, reader, tc, NULL, 1);
+    if (item)
+      _epub_print_debug(opf->epub, DEBUG_WARNING, 
+                        "nav info inside %s element", kind);
+    break;
+
+  case OPF_ELEMENT_CONTENT:
+    if (item) {
+      item->src = _epub_xml_attribute_offset(opf->epub, reader, "src");
+      src = (char *)_epub_str(opf->epub, item->src);
+      if (src)
+        url_decode(src, strlen(src));
+    }
+    else
+      _epub_print_debug(opf->epub, DEBUG_WARNING, 
+                        "content not inside %s element", kind);  
+    break;
+
+  default:
+    break;
+  }
 }
 
 int _get_attribute_as_positive_int(xmlTextReaderPtr reader, const xmlChar *name) {
@@ -363,36 +525,47 @@ int _get_attribute_as_positive_int(xmlTextReaderPtr reader, const xmlChar *name)
 }
 
 void _opf_parse_navmap(struct opf *opf, xmlTextReaderPtr reader) {
-  int ret;
+  enum opf_element element;
+  int ret, nodeType;
   int depth = 0;
 
-  struct tocCategory *tc = _opf_init_toc_category();
-  struct tocItem *item = NULL;
+  struct tocCategory *tc = _opf_init_toc_category(opf);
+  struct tocItem cur, *item = NULL; // the item being parsed
 
   _epub_print_debug(opf->epub, DEBUG_INFO, "parsing nav map");
 
-  tc->id = xmlTextReaderGetAttribute(reader, (xmlChar *)"id");
+  if (! tc)
+    return;
+
+  tc->id = _epub_xml_attribute(opf->epub, reader, "id");
 
   ret = xmlTextReaderRead(reader);
   while (ret == 1 && 
-         xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navMap")) {
+         (element = _opf_element(xmlTextReaderConstName(reader))) != 
+         OPF_ELEMENT_NAVMAP) {
+    nodeType = xmlTextReaderNodeType(reader);
 
-    if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navPoint")) {
-      if (xmlTextReaderNodeType(reader) == 1) {
+    if (element == OPF_ELEMENT_NAVPOINT) {
+      if (nodeType == 1) {
 
         if (item) {
           _epub_print_debug(opf->epub, DEBUG_INFO, 
                             "adding nav point item->%s %s (d:%d,p:%d)", 
-                            item->id, item->src, item->depth, item->playOrder);
-          AddNode(tc->items, NewListNode(tc->items, item));
-          AddNode(opf->toc->playOrder, NewListNode(opf->toc->playOrder, item));
+                            _epub_str(opf->epub, item->id),
+                            _epub_str(opf->epub, item->src), 
+                            item->depth, item->playOrder);
+          VECTOR_ADD(opf->epub, tc->items, *item);
           item = NULL;
         }
 
         depth++;
-        item = _opf_init_toc_item(depth);
-        item->id = xmlTextReaderGetAttribute(reader, (xmlChar *)"id");
-        item->class = xmlTextReaderGetAttribute(reader, (xmlChar *)"class");
+        item = &cur;
+        _opf_init_toc_item(item, depth);
+        item->id = _epub_xml_attribute_offset(opf->epub, reader, "id");
+        item->class = 
+          strpool_offset(opf->epub->strings, 
+                         (char *)_epub_xml_attribute_interned(opf->epub, reader,
+                                                              "class"));
         
         item->playOrder = _get_attribute_as_positive_int(reader, (xmlChar *)"playOrder");
         if (item->playOrder == -1) {
@@ -400,52 +573,22 @@ void _opf_parse_navmap(struct opf *opf, xmlTextReaderPtr reader) {
                             "- missing play order in nav point element");
         }
      
-      } else if (xmlTextReaderNodeType(reader) == 15) {
+      } else if (nodeType == 15) {
         if (item) {
           _epub_print_debug(opf->epub, DEBUG_INFO, 
                             "adding nav point item->%s %s (d:%d,p:%d)", 
-                            item->id, item->src, item->depth, item->playOrder);
-          AddNode(tc->items, NewListNode(tc->items, item)); 
-          AddNode(opf->toc->playOrder, NewListNode(opf->toc->playOrder, item));
+                            _epub_str(opf->epub, item->id),
+                            _epub_str(opf->epub, item->src), 
+                            item->depth, item->playOrder);
+          VECTOR_ADD(opf->epub, tc->items, *item);
           item = NULL;
         }
         depth--;
       }
+    } else if (nodeType == 1) {
+      _opf_parse_toc_child(opf, reader, element, tc, item, "nav point");
     }
-  
-    // ignore non starting tags
-    if (xmlTextReaderNodeType(reader) != 1) {
-      ret = xmlTextReaderRead(reader);
-      continue;
-    }
-    
-    if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navLabel")) {
-      if (item) {
-        if (! item->label)
-          item->label = NewListAlloc(LIST, NULL, NULL, NULL); //tocLabel
-        AddNode(item->label, NewListNode(item->label, 
-                                         _opf_parse_navlabel(opf, reader)));
-      } else { // Not inside navpoint
-        AddNode(tc->label, NewListNode(tc->label, 
-                                       _opf_parse_navlabel(opf, reader)));
-      }
-    } else if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navInfo")) {
-        AddNode(tc->info, NewListNode(tc->info, 
-                                      _opf_parse_navlabel(opf, reader)));
-        if (item)
-          _epub_print_debug(opf->epub, DEBUG_WARNING, 
-                            "nav info inside nav point element");
-    } else 
-      if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"content")) {
-        if (item) {
-          item->src = xmlTextReaderGetAttribute(reader, (xmlChar *)"src");
-          url_decode(item->src, strlen(item->src));
-        }
-        else
-          _epub_print_debug(opf->epub, DEBUG_WARNING, 
-                            "content not inside nav point element");  
-      }
-    
+
     ret = xmlTextReaderRead(reader);
   }
 
@@ -454,25 +597,35 @@ void _opf_parse_navmap(struct opf *opf, xmlTextReaderPtr reader) {
 }
 
 void _opf_parse_navlist(struct opf *opf, xmlTextReaderPtr reader) {
-  int ret;
+  enum opf_element element;
+  int ret, nodeType;
 
-  struct tocCategory *tc = _opf_init_toc_category();
-  struct tocItem *item = NULL;
+  struct tocCategory *tc = _opf_init_toc_category(opf);
+  struct tocItem cur, *item = NULL; // the item being parsed
 
-  tc->id = xmlTextReaderGetAttribute(reader, (xmlChar *)"id");
-  tc->class = xmlTextReaderGetAttribute(reader, (xmlChar *)"class");
+  if (! tc)
+    return;
+
+  tc->id = _epub_xml_attribute(opf->epub, reader, "id");
+  tc->class = _epub_xml_attribute_interned(opf->epub, reader, "class");
     
   _epub_print_debug(opf->epub, DEBUG_INFO, "parsing nav list");
 
   ret = xmlTextReaderRead(reader);
   while (ret == 1 && 
-         xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navList")) {
-
-    if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navTarget")) {
-      if (xmlTextReaderNodeType(reader) == 1) {
-        item = _opf_init_toc_item(1);
-        item->id = xmlTextReaderGetAttribute(reader, (xmlChar *)"id");
-        item->class = xmlTextReaderGetAttribute(reader, (xmlChar *)"class");
+         (element = _opf_element(xmlTextReaderConstName(reader))) != 
+         OPF_ELEMENT_NAVLIST) {
+    nodeType = xmlTextReaderNodeType(reader);
+
+    if (element == OPF_ELEMENT_NAVTARGET) {
+      if (nodeType == 1) {
+        item = &cur;
+        _opf_init_toc_item(item, 1);
+        item->id = _epub_xml_attribute_offset(opf->epub, reader, "id");
+        item->class = 
+          strpool_offset(opf->epub->strings, 
+                         (char *)_epub_xml_attribute_interned(opf->epub, reader,
+                                                              "class"));
         
         item->playOrder = _get_attribute_as_positive_int(reader, (xmlChar *)"playOrder");
         if (item->playOrder == -1) {
@@ -480,52 +633,22 @@ void _opf_parse_navlist(struct opf *opf, xmlTextReaderPtr reader) {
                             "- missing play order in nav target element");
         }
         item->value = _get_attribute_as_positive_int(reader, (xmlChar *)"value"); 
-      } else if (xmlTextReaderNodeType(reader) == 15) {
+      } else if (nodeType == 15) {
         if (item) {
           _epub_print_debug(opf->epub, DEBUG_INFO, 
                             "adding nav target item->%s %s (d:%d,p:%d)", 
-                            item->id, item->src, item->depth, item->playOrder);
-          AddNode(tc->items, NewListNode(tc->items, item)); 
-          AddNode(opf->toc->playOrder, NewListNode(opf->toc->playOrder, item));
+                            _epub_str(opf->epub, item->id),
+                            _epub_str(opf->epub, item->src), 
+                            item->depth, item->playOrder);
+          VECTOR_ADD(opf->epub, tc->items, *item);
           item = NULL;
         } else {
           _epub_print_debug(opf->epub, DEBUG_ERROR, "empty item in nav list"); 
         }
       }
+    } else if (nodeType == 1) {
+      _opf_parse_toc_child(opf, reader, element, tc, item, "nav target");
     }
-  
-    
-    // ignore non starting tags
-    if (xmlTextReaderNodeType(reader) != 1) {
-      ret = xmlTextReaderRead(reader);
-      continue;
-    }
-    if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navLabel")) {
-      if (item) {
-        if (! item->label)
-          item->label = NewListAlloc(LIST, NULL, NULL, NULL); //tocLabel
-        AddNode(item->label, NewListNode(item->label, 
-                                         _opf_parse_navlabel(opf, reader)));
-      } else { // Not inside navpoint
-        AddNode(tc->label, NewListNode(tc->label, 
-                                       _opf_parse_navlabel(opf, reader)));
-      }
-    } else if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navInfo")) {
-      AddNode(tc->info, NewListNode(tc->info, 
-                                    _opf_parse_navlabel(opf, reader)));
-      if (item)
-        _epub_print_debug(opf->epub, DEBUG_WARNING, 
-                          "nav info inside nav target element");
-    } else 
-      if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"content")) {
-        if (item) {
-          item->src = xmlTextReaderGetAttribute(reader, (xmlChar *)"src");
-          url_decode(item->src, strlen(item->src));
-        }
-        else
-          _epub_print_debug(opf->epub, DEBUG_WARNING, 
-                            "content not inside nav target element");  
-      }
 
     ret = xmlTextReaderRead(reader);
   }
@@ -536,24 +659,38 @@ void _opf_parse_navlist(struct opf *opf, xmlTextReaderPtr reader) {
 }
 
 void _opf_parse_pagelist(struct opf *opf, xmlTextReaderPtr reader) {
-  int ret;
-  struct tocCategory *tc = _opf_init_toc_category();
-  struct tocItem *item = NULL;
+  enum opf_element element;
+  int ret, nodeType;
+  struct tocCategory *tc = _opf_init_toc_category(opf);
+  struct tocItem cur, *item = NULL; // the item being parsed
   
-  tc->id = xmlTextReaderGetAttribute(reader, (xmlChar *)"id");
-  tc->class = xmlTextReaderGetAttribute(reader, (xmlChar *)"class");
+  if (! tc)
+    return;
+
+  tc->id = _epub_xml_attribute(opf->epub, reader, "id");
+  tc->class = _epub_xml_attribute_interned(opf->epub, reader, "class");
   
   _epub_print_debug(opf->epub, DEBUG_INFO, "parsing page list");
   
   ret = xmlTextReaderRead(reader);
   while (ret == 1 && 
-         xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"pageList")) {
-    if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"pageTarget")) {
-      if (xmlTextReaderNodeType(reader) == 1) {
-        item = _opf_init_toc_item(1);
-        item->id = xmlTextReaderGetAttribute(reader, (xmlChar *)"id");
-        item->class = xmlTextReaderGetAttribute(reader, (xmlChar *)"class");
-        item->type  = xmlTextReaderGetAttribute(reader, (xmlChar *)"type");
+         (element = _opf_element(xmlTextReaderConstName(reader))) != 
+         OPF_ELEMENT_PAGELIST) {
+    nodeType = xmlTextReaderNodeType(reader);
+
+    if (element == OPF_ELEMENT_PAGETARGET) {
+      if (nodeType == 1) {
+        item = &cur;
+        _opf_init_toc_item(item, 1);
+        item->id = _epub_xml_attribute_offset(opf->epub, reader, "id");
+        item->class = 
+          strpool_offset(opf->epub->strings, 
+                         (char *)_epub_xml_attribute_interned(opf->epub, reader,
+                                                              "class"));
+        item->type = 
+          strpool_offset(opf->epub->strings, 
+                         (char *)_epub_xml_attribute_interned(opf->epub, reader,
+                                                              "type"));
         
         item->playOrder = _get_attribute_as_positive_int(reader, (xmlChar *)"playOrder");
         if (item->playOrder == -1) {
@@ -561,72 +698,36 @@ void _opf_parse_pagelist(struct opf *opf, xmlTextReaderPtr reader) {
                             "- missing play order in page target element");
         }
         item->value = _get_attribute_as_positive_int(reader, (xmlChar *)"value"); 
-      } else if (xmlTextReaderNodeType(reader) == 15) {
+      } else if (nodeType == 15) {
         if (item) {
           _epub_print_debug(opf->epub, DEBUG_INFO, 
                             "adding page target item->%s %s (d:%d,p:%d)", 
-                            item->id, item->src, item->depth, item->playOrder);
-          AddNode(tc->items, NewListNode(tc->items, item)); 
-          AddNode(opf->toc->playOrder, NewListNode(opf->toc->playOrder, item));
+                            _epub_str(opf->epub, item->id),
+                            _epub_str(opf->epub, item->src), 
+                            item->depth, item->playOrder);
+          VECTOR_ADD(opf->epub, tc->items, *item);
           item = NULL;
         } else {
           _epub_print_debug(opf->epub, DEBUG_ERROR, "empty item in nav list"); 
         }
       }
+    } else if (nodeType == 1) {
+      _opf_parse_toc_child(opf, reader, element, tc, item, "page target");
     }
 
-     // ignore non starting tags
-    if (xmlTextReaderNodeType(reader) != 1) {
-      ret = xmlTextReaderRead(reader);
-      continue;
-    }
-
-    if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navLabel")) {
-      if (item) {
-        if (! item->label)
-          item->label = NewListAlloc(LIST, NULL, NULL, NULL); //tocLabel
-        AddNode(item->label, NewListNode(item->label, 
-                                         _opf_parse_navlabel(opf, reader)));
-      } else { // Not inside navpoint
-        AddNode(tc->label, NewListNode(tc->label, 
-                                       _opf_parse_navlabel(opf, reader)));
-      }
-    } else if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"navInfo")) {
-      AddNode(tc->info, NewListNode(tc->info, 
-                                    _opf_parse_navlabel(opf, reader)));
-      if (item)
-        _epub_print_debug(opf->epub, DEBUG_WARNING, 
-                          "nav info inside page target element");
-    } else 
-      if (! xmlStrcasecmp(xmlTextReaderConstName(reader),(xmlChar *)"content")) {
-        if (item) {
-          item->src = xmlTextReaderGetAttribute(reader, (xmlChar *)"src");
-          url_decode(item->src, strlen(item->src));
-        }
-        else
-          _epub_print_debug(opf->epub, DEBUG_WARNING, 
-                            "content not inside nav target element");  
-      }
-
     ret = xmlTextReaderRead(reader);
   }
   
-  opf->toc->navList = tc;
+  opf->toc->pageList = tc;
   _epub_print_debug(opf->epub, DEBUG_INFO, "finished parsing page list");
     
 }
 
-void _opf_parse_toc(struct opf *opf, char *tocStr, int size) {
-
+// Reads the toc through the text reader
+void _opf_read_toc(struct opf *opf, char *tocStr, int size) {
   xmlTextReaderPtr reader;
   int ret;
 
-  _epub_print_debug(opf->epub, DEBUG_INFO, "building toc");
-  
-  opf->toc = _opf_init_toc();
-  
-  _epub_print_debug(opf->epub, DEBUG_INFO, "parsing toc");
-  
   reader = xmlReaderForMemory(tocStr, size, "TOC", NULL, 0);
   
   if (reader != NULL) {
@@ -634,15 +735,19 @@ void _opf_parse_toc(struct opf *opf, char *tocStr, int size) {
     
     while (ret == 1) {
       
-      const xmlChar *name = xmlTextReaderConstName(reader);
-      if (xmlStrcasecmp(name, (xmlChar *)"navList") == 0)
+      switch (_opf_element(xmlTextReaderConstName(reader))) {
+      case OPF_ELEMENT_NAVLIST:
         _opf_parse_navlist(opf, reader);
-      else 
-      if (xmlStrcasecmp(name, (xmlChar *)"navMap") == 0)
+        break;
+      case OPF_ELEMENT_NAVMAP:
         _opf_parse_navmap(opf, reader);
-      else 
-      if (xmlStrcasecmp(name, (xmlChar *)"pageList") == 0)
+        break;
+      case OPF_ELEMENT_PAGELIST:
         _opf_parse_pagelist(opf, reader);
+        break;
+      default:
+        break;
+      }
 
       ret = xmlTextReaderRead(reader);
     }
@@ -654,45 +759,100 @@ void _opf_parse_toc(struct opf *opf, char *tocStr, int size) {
   } else {
     _epub_print_debug(opf->epub, DEBUG_ERROR, "unable to open toc reader");
   }
+}
+
+void _opf_parse_toc(struct opf *opf, char *tocStr, int size) {
+  _epub_print_debug(opf->epub, DEBUG_INFO, "building toc");
+  
+  if (! (opf->toc = _opf_init_toc(opf)))
+    return;
+  
+  _epub_print_debug(opf->epub, DEBUG_INFO, "parsing toc");
+
+  if (opf->epub->flags & EPUB_OPEN_SAX)
+    _opf_sax_toc(opf, tocStr, size);
+  else
+    _opf_read_toc(opf, tocStr, size);
 
-  SortList(opf->toc->playOrder);
   _epub_print_debug(opf->epub, DEBUG_INFO, "finished parsing toc");
 }      
 
+// Parses the toc named in the spine unless that was already done
+void _opf_load_toc(struct opf *opf) {
+  char *tocStr = NULL;
+  struct manifest *item;
+  int size;
+
+  if (opf->tocLoaded)
+    return;
+  opf->tocLoaded = 1;
+
+  if (! opf->tocName)
+    return;
+
+  item = _opf_manifest_get_by_id(opf, opf->tocName);
+  if (item != NULL) {
+    size = _ocf_get_file_index(opf->epub->ocf, item->index, &tocStr);
+		
+    if (size <= 0) {
+      _epub_print_debug(opf->epub, DEBUG_ERROR, "Faulty toc file %s",
+                        opf->tocName);
+    } else {
+      _opf_parse_toc(opf, tocStr, size);
+      _opf_resolve_toc_labels(opf);
+    }
+    free(tocStr);
+  } else {
+    _epub_print_debug(opf->epub, DEBUG_ERROR, "Toc not in manifest (-) %s",
+                      opf->tocName);
+  }
+}
+
+// Sets the linear and spread position of a spine item from its
+// attributes (NULL if missing)
+void _opf_set_spine_properties(struct opf *opf, struct spine *item,
+                               const xmlChar *linear,
+                               const xmlChar *properties) {
+  if (linear && xmlStrcasecmp(linear, (xmlChar *)"no") == 0) {
+    item->linear = 0;
+  } else {
+    item->linear = 1;
+    opf->linearCount++;
+  }
+
+  if (! properties)
+    item->spreadPosition = PAGE_SPREAD_UNKNOWN;
+  else if (xmlStrcasecmp(properties, 
+                         (xmlChar *)"rendition:page-spread-center") == 0)
+    item->spreadPosition = PAGE_SPREAD_CENTER;
+  else if (xmlStrcasecmp(properties, (xmlChar *)"page-spread-left") == 0)
+    item->spreadPosition = PAGE_SPREAD_LEFT;
+  else if (xmlStrcasecmp(properties, (xmlChar *)"page-spread-right") == 0)
+    item->spreadPosition = PAGE_SPREAD_RIGHT;
+  else
+    item->spreadPosition = PAGE_SPREAD_UNKNOWN;
+}
+
 void _opf_parse_spine(struct opf *opf, xmlTextReaderPtr reader) {
   int ret;
   xmlChar *linear, *properties;
 
   _epub_print_debug(opf->epub, DEBUG_INFO, "parsing spine");
   
-  opf->spine = NewListAlloc(LIST, NULL, NULL, NULL); 
-  opf->tocName = xmlTextReaderGetAttribute(reader, (xmlChar *)"toc");
+  opf->spine = arena_zalloc(opf->epub->arena, sizeof(*opf->spine));
+  if (! opf->spine) {
+    _epub_err_set_oom(&opf->epub->error);
+    return;
+  }
+  opf->tocName = _epub_xml_attribute(opf->epub, reader, "toc");
   
+  // the toc is parsed on first use, see _opf_load_toc, or alongside the
+  // rest of the package, see _opf_toc_start
   if (opf->tocName) { 
-    char *tocStr = NULL;
-    struct manifest *item;
-    int size;
-
     _epub_print_debug(opf->epub, DEBUG_INFO, "toc is %s", opf->tocName);
-    
-    item = _opf_manifest_get_by_id(opf, opf->tocName);
-	if (item != NULL) {
-		size = _ocf_get_data_file(opf->epub->ocf, (char *)item->href, &tocStr);
-		
-		if (size <= 0) {
-			_epub_print_debug(opf->epub, DEBUG_ERROR, "Faulty toc file %s",
-							  opf->tocName);
-		} else {
-			_opf_parse_toc(opf, tocStr, size);
-			free(tocStr);
-		}
-	} else {
-		_epub_print_debug(opf->epub, DEBUG_ERROR, "Toc not in manifest (-) %s",
-						  opf->tocName);
-	}
+    _opf_toc_start(opf);
   } else {
     _epub_print_debug(opf->epub, DEBUG_WARNING, "toc not found (-)"); 
-    opf->toc = NULL;
   }
 
   
@@ -707,41 +867,19 @@ void _opf_parse_spine(struct opf *opf, xmlTextReaderPtr reader) {
       continue;
     }
 
-    item = malloc(sizeof(struct spine));
-	memset(item, 0, sizeof(struct spine));
+    if (! (item = VECTOR_PUSH(opf->epub, *opf->spine)))
+      break;
 
-    item->idref = xmlTextReaderGetAttribute(reader, (xmlChar *)"idref");
+    item->idref = _epub_xml_attribute(opf->epub, reader, "idref");
     linear = xmlTextReaderGetAttribute(reader, (xmlChar *)"linear");
-    if (linear && xmlStrcasecmp(linear, (xmlChar *)"no") == 0) {
-      item->linear = 0;
-    } else {
-        item->linear = 1;
-        opf->linearCount++;
-    }
+    properties = xmlTextReaderGetAttribute(reader, (xmlChar *)"properties");
+    _opf_set_spine_properties(opf, item, linear, properties);
 
     if(linear)
         free(linear);
-
-    properties = xmlTextReaderGetAttribute(reader, (xmlChar *)"properties");
-    if (properties) {
-      if (xmlStrcasecmp(properties, (xmlChar *)"rendition:page-spread-center") == 0) {
-        item->spreadPosition = PAGE_SPREAD_CENTER;
-      } else if (xmlStrcasecmp(properties, (xmlChar *)"page-spread-left") == 0) {
-        item->spreadPosition = PAGE_SPREAD_LEFT;
-      } else if (xmlStrcasecmp(properties, (xmlChar *)"page-spread-right") == 0) {
-        item->spreadPosition = PAGE_SPREAD_RIGHT;
-      } else {
-        item->spreadPosition = PAGE_SPREAD_UNKNOWN;
-      }
-    } else {
-      item->spreadPosition = PAGE_SPREAD_UNKNOWN;
-    }
-
     if(properties)
         free(properties);
 
-     AddNode(opf->spine, NewListNode(opf->spine, item));
-     
     // decide what to do with non linear items
     _epub_print_debug(opf->epub, DEBUG_INFO, "found item %s", item->idref);
     
@@ -749,19 +887,110 @@ void _opf_parse_spine(struct opf *opf, xmlTextReaderPtr reader) {
   }
 }
 
+// Starts a manifest, a second one replaces the first one
+void _opf_begin_manifest(struct opf *opf) {
+  free(opf->manifest);
+  hash_free(opf->manifestById);
+  hash_free(opf->manifestByPath);
+  opf->manifest = NULL;
+  opf->manifestById = opf->manifestByPath = NULL;
+  opf->manifestCount = opf->manifestAlloc = 0;
+}
+
+// Returns a new zeroed manifest item or NULL on failure
+struct manifest *_opf_add_manifest_item(struct opf *opf) {
+  struct manifest *item;
+
+  // the items are stored contiguously, the hashes are filled once
+  // they stop moving
+  if (opf->manifestCount == opf->manifestAlloc) {
+    item = realloc(opf->manifest, (opf->manifestAlloc ? 
+                                   opf->manifestAlloc * 2 : 16) *
+                   sizeof(struct manifest));
+    if (! item) {
+      _epub_err_set_oom(&opf->epub->error);
+      return NULL;
+    }
+    opf->manifest = item;
+    opf->manifestAlloc = opf->manifestAlloc ? opf->manifestAlloc * 2 : 16;
+  }
+
+  item = &opf->manifest[opf->manifestCount++];
+  memset(item, 0, sizeof(struct manifest));
+
+  return item;
+}
+
+// Decodes the href of an item whose attributes were read and resolves
+// its archive entry once so reads need no name lookups
+void _opf_resolve_manifest_item(struct opf *opf, struct manifest *item) {
+  struct epub *epub = opf->epub;
+  char *path, *href;
+
+  href = (char *)_epub_str(epub, item->href);
+  if (href)
+    url_decode(href, strlen(href));
+
+  path = _ocf_data_name(epub->ocf, href);
+  item->path = strpool_offset(epub->strings, 
+                              strpool_strdup(epub->strings, path));
+  free(path);
+  item->index = -1;
+  if (item->path)
+    item->index = _ocf_check_file(epub->ocf, 
+                                  (char *)_epub_str(epub, item->path));
+  item->spineIndex = -1;
+    
+  _epub_print_debug(epub, DEBUG_INFO, 
+                    "manifest item %s href %s media-type %s", 
+                    _epub_str(epub, item->id), href,
+                    _epub_str(epub, item->type));
+}
+
+// Indexes the items of the manifest once it is read
+void _opf_index_manifest(struct opf *opf) {
+  struct epub *epub = opf->epub;
+  struct manifest *item;
+  int i, ret;
+
+  opf->manifestById = hash_new((HashKeyFunc)_list_key_manifest_id, 
+                               epub->strings, opf->manifestCount);
+  opf->manifestByPath = hash_new((HashKeyFunc)_list_key_manifest_path, 
+                                 epub->strings, opf->manifestCount);
+  if (! opf->manifestById || ! opf->manifestByPath) {
+    _epub_err_set_oom(&epub->error);
+    return;
+  }
+
+  for (i = 0; i < opf->manifestCount; i++) {
+    item = &opf->manifest[i];
+    ret = 0;
+    if (item->id && (ret = hash_add(opf->manifestById, item)) == 0)
+      _epub_print_debug(epub, DEBUG_WARNING, 
+                        "duplicate manifest id %s", _epub_str(epub, item->id));
+    if (ret != -1 && item->path)
+      ret = hash_add(opf->manifestByPath, item);
+
+    // the items left would look missing
+    if (ret == -1) {
+      _epub_err_set_oom(&epub->error);
+      return;
+    }
+  }
+}
+
 void _opf_parse_manifest(struct opf *opf, xmlTextReaderPtr reader) {
+  struct epub *epub = opf->epub;
+  struct manifest *item;
   int ret;
   
-  _epub_print_debug(opf->epub, DEBUG_INFO, "parsing manifest");
-
-  opf->manifest = NewListAlloc(LIST, NULL, NULL, 
-                               (NodeCompareFunc)_list_cmp_manifest_by_id );
+  _epub_print_debug(epub, DEBUG_INFO, "parsing manifest");
+  _opf_begin_manifest(opf);
 
   ret = xmlTextReaderRead(reader);
 
   while (ret == 1 && 
          xmlStrcasecmp(xmlTextReaderConstLocalName(reader),(xmlChar *)"manifest")) {
-    struct manifest *item;
 
     // ignore non starting tags
     if (xmlTextReaderNodeType(reader) != 1) {
@@ -769,36 +998,56 @@ void _opf_parse_manifest(struct opf *opf, xmlTextReaderPtr reader) {
       continue;
     }
 
-    item = malloc(sizeof(struct manifest));
+    if (! (item = _opf_add_manifest_item(opf)))
+      break;
 
-    item->id = xmlTextReaderGetAttribute(reader, (xmlChar *)"id");
-    item->href = xmlTextReaderGetAttribute(reader, (xmlChar *)"href");
-    url_decode(item->href, strlen(item->href));
-    item->type = xmlTextReaderGetAttribute(reader, (xmlChar *)"media-type");
-    item->fallback = xmlTextReaderGetAttribute(reader, (xmlChar *)"fallback");
+    item->id = _epub_xml_attribute_offset(epub, reader, "id");
+    item->href = _epub_xml_attribute_offset(epub, reader, "href");
+    item->type = 
+      strpool_offset(epub->strings, 
+                     (char *)_epub_xml_attribute_interned(epub, reader, 
+                                                          "media-type"));
+    item->fallback = _epub_xml_attribute_offset(epub, reader, "fallback");
     item->fbStyle = 
-      xmlTextReaderGetAttribute(reader, (xmlChar *)"fallback-style");
+      _epub_xml_attribute_offset(epub, reader, "fallback-style");
     item->nspace = 
-      xmlTextReaderGetAttribute(reader, (xmlChar *)"required-namespace");
+      _epub_xml_attribute_offset(epub, reader, "required-namespace");
     item->modules = 
-      xmlTextReaderGetAttribute(reader, (xmlChar *)"required-modules");
-    
-    _epub_print_debug(opf->epub, DEBUG_INFO, 
-                      "manifest item %s href %s media-type %s", 
-                      item->id, item->href, item->type);
-
-    AddNode(opf->manifest, NewListNode(opf->manifest, item));
+      _epub_xml_attribute_offset(epub, reader, "required-modules");
+    _opf_resolve_manifest_item(opf, item);
 
     ret = xmlTextReaderRead(reader);
   }
+
+  _opf_index_manifest(opf);
 }
 
 struct manifest *_opf_manifest_get_by_id(struct opf *opf, xmlChar* id) {
-  struct manifest data;
-  data.id = id;
-  
-  return FindNode(opf->manifest, &data);
-  
+  return hash_get(opf->manifestById, (char *)id);
+}
+
+// Finds the manifest item of an href relative to the data directory. 
+// The fragment is ignored and escapes are decoded like manifest hrefs.
+struct manifest *_opf_manifest_get_by_href(struct opf *opf, const char *href) {
+  struct manifest *item;
+  char *name, *path, *fragment;
+
+  if (! (name = strdup(href))) {
+    _epub_err_set_oom(&opf->epub->error);
+    return NULL;
+  }
+
+  if ((fragment = strchr(name, '#')))
+    *fragment = 0;
+  url_decode(name, strlen(name));
+
+  path = _ocf_data_name(opf->epub->ocf, name);
+  free(name);
+
+  item = hash_get(opf->manifestByPath, path);
+  free(path);
+
+  return item;
 }
 
 void _opf_parse_guide(struct opf *opf, xmlTextReaderPtr reader) {
@@ -807,7 +1056,11 @@ void _opf_parse_guide(struct opf *opf, xmlTextReaderPtr reader) {
 
   _epub_print_debug(opf->epub, DEBUG_INFO, "parsing guides");
 
-  opf->guide = NewListAlloc(LIST, NULL, NULL, NULL);
+  opf->guide = arena_zalloc(opf->epub->arena, sizeof(*opf->guide));
+  if (! opf->guide) {
+    _epub_err_set_oom(&opf->epub->error);
+    return;
+  }
 
   ret = xmlTextReaderRead(reader);
   while (ret == 1 && 
@@ -819,22 +1072,22 @@ void _opf_parse_guide(struct opf *opf, xmlTextReaderPtr reader) {
       continue;
     }
     
-    item = malloc(sizeof(struct guide));
-    item->type = xmlTextReaderGetAttribute(reader, (xmlChar *)"type");
-    item->title = xmlTextReaderGetAttribute(reader, (xmlChar *)"title");
-    item->href = xmlTextReaderGetAttribute(reader, (xmlChar *)"href");
+    if (! (item = VECTOR_PUSH(opf->epub, *opf->guide)))
+      break;
+    item->type = _epub_xml_attribute(opf->epub, reader, "type");
+    item->title = _epub_xml_attribute(opf->epub, reader, "title");
+    item->href = _epub_xml_attribute(opf->epub, reader, "href");
 
     _epub_print_debug(opf->epub, DEBUG_INFO, 
                       "guide item: %s href: %s type: %s", 
                       item->title, item->href, item->type);
-    AddNode(opf->guide, NewListNode(opf->guide, item));
     ret = xmlTextReaderRead(reader);
   }
 }
 
-listPtr _opf_parse_tour(struct opf *opf, xmlTextReaderPtr reader) {
+void _opf_parse_tour(struct opf *opf, xmlTextReaderPtr reader, 
+                     struct tour *tour) {
   int ret;
-  listPtr tour = NewListAlloc(LIST, NULL, NULL, NULL);
   struct site *item;
 
   ret = xmlTextReaderRead(reader);
@@ -848,18 +1101,16 @@ listPtr _opf_parse_tour(struct opf *opf, xmlTextReaderPtr reader) {
       continue;
     }
     
-    item = malloc(sizeof(struct site));
-    item->title = xmlTextReaderGetAttribute(reader, (xmlChar *)"title");
-    item->href = xmlTextReaderGetAttribute(reader, (xmlChar *)"href");
+    if (! (item = VECTOR_PUSH(opf->epub, tour->sites)))
+      break;
+    item->title = _epub_xml_attribute(opf->epub, reader, "title");
+    item->href = _epub_xml_attribute(opf->epub, reader, "href");
     _epub_print_debug(opf->epub, DEBUG_INFO, 
                       "site: %s href: %s", 
                       item->title, item->href);
-    AddNode(tour, NewListNode(tour, item));
 
     ret = xmlTextReaderRead(reader);
   }
-
-  return tour;
 }
 
 void _opf_parse_tours(struct opf *opf, xmlTextReaderPtr reader) {
@@ -868,7 +1119,11 @@ void _opf_parse_tours(struct opf *opf, xmlTextReaderPtr reader) {
 
   _epub_print_debug(opf->epub, DEBUG_INFO, "parsing tours");
 
-  opf->tours = NewListAlloc(LIST, NULL, NULL, NULL);
+  opf->tours = arena_zalloc(opf->epub->arena, sizeof(*opf->tours));
+  if (! opf->tours) {
+    _epub_err_set_oom(&opf->epub->error);
+    return;
+  }
 
   ret = xmlTextReaderRead(reader);
   
@@ -881,71 +1136,128 @@ void _opf_parse_tours(struct opf *opf, xmlTextReaderPtr reader) {
       continue;
     }
     
-    item = malloc(sizeof(struct tour));
+    if (! (item = VECTOR_PUSH(opf->epub, *opf->tours)))
+      break;
    
-    item->title = xmlTextReaderGetAttribute(reader, (xmlChar *)"title");
-    item->id = xmlTextReaderGetAttribute(reader, (xmlChar *)"id");
+    item->title = _epub_xml_attribute(opf->epub, reader, "title");
+    item->id = _epub_xml_attribute(opf->epub, reader, "id");
     _epub_print_debug(opf->epub, DEBUG_INFO, 
                       "tour: %s id: %s", 
                       item->title, item->id);
-    item->sites = _opf_parse_tour(opf, reader);
-    AddNode(opf->tours, NewListNode(opf->tours, item));
+    _opf_parse_tour(opf, reader, item);
 
     ret = xmlTextReaderRead(reader);
   }
 }
 
-xmlChar *_opf_label_get_by_lang(struct opf *opf, listPtr label, char *lang) {
-  struct tocLabel data, *tmp;
-  data.lang = (xmlChar *)lang;
-  label->compare = (NodeCompareFunc)_list_cmp_label_by_lang;
-  tmp =  FindNode(label, &data);
-  return (tmp?tmp->text:NULL);
-  
+// Returns the text of the first label in lang. Labels without a language
+// match any and so does a NULL lang.
+xmlChar *_opf_label_get_by_lang(struct opf *opf, struct tocLabel *labels,
+                                int count, const char *lang) {
+  // the languages of the labels are interned, a language no label has
+  // isn't and matches none of them
+  const xmlChar *interned = lang ? hash_get(opf->epub->interned, lang) : NULL;
+  int i;
+
+  for (i = 0; i < count; i++) {
+    if (! lang || ! labels[i].lang || labels[i].lang == interned)
+      return labels[i].text;
+  }
+
+  return NULL;
+}
+
+xmlChar *_opf_label_get_by_doc_lang(struct opf *opf, struct tocLabel *labels,
+                                    int count) {
+  struct metadata *meta = opf->metadata;
+
+  return _opf_label_get_by_lang(opf, labels, count, 
+                                meta && meta->lang.count ? 
+                                (char *)meta->lang.items[0] : NULL);
 }
 
-xmlChar *_opf_label_get_by_doc_lang(struct opf *opf, listPtr label) {
-  opf->metadata->lang->Current = opf->metadata->lang->Head;
-  return _opf_label_get_by_lang(opf, label, 
-                                (char *)GetNode(opf->metadata->lang));
+// Returns the text of the first label in the languages the caller
+// prefers, or else in the language of the book
+xmlChar *_opf_label_get_preferred(struct opf *opf, struct tocLabel *labels,
+                                  int count) {
+  xmlChar *text = NULL;
+  int i;
+
+  for (i = 0; ! text && i < opf->labelLangs.count; i++)
+    text = _opf_label_get_by_lang(opf, labels, count,
+                                  (char *)opf->labelLangs.items[i]);
+
+  return text ? text : _opf_label_get_by_doc_lang(opf, labels, count);
+}
+
+void _opf_resolve_category_labels(struct opf *opf, struct tocCategory *tc) {
+  struct tocItem *item;
+  int i;
+
+  tc->text = _opf_label_get_preferred(opf, tc->label.items, tc->label.count);
+
+  for (i = 0; i < tc->items.count; i++) {
+    item = &tc->items.items[i];
+    item->text = _opf_label_get_preferred(opf, 
+                                          &opf->toc->labels.items[item->label],
+                                          item->labelCount);
+    // unlabeled items show their id
+    if (! item->text)
+      item->text = _epub_str(opf->epub, item->id);
+  }
+}
+
+// Picks the label shown for every toc item once, so the toc iterators
+// only hand them out. Done again when the preferred languages change.
+void _opf_resolve_toc_labels(struct opf *opf) {
+  struct toc *toc = opf->toc;
+
+  if (! toc)
+    return;
+
+  if (toc->navMap)
+    _opf_resolve_category_labels(opf, toc->navMap);
+  if (toc->pageList)
+    _opf_resolve_category_labels(opf, toc->pageList);
+  if (toc->navList)
+    _opf_resolve_category_labels(opf, toc->navList);
 }
 
 void _opf_dump(struct opf *opf) {
+  struct metadata *meta = opf->metadata;
+  int i;
+
   printf("Title(s):\n   ");
-  DumpList(opf->metadata->title, (ListDumpFunc)_list_dump_string);
+  for (i = 0; i < meta->title.count; i++)
+    _list_dump_string((char *)meta->title.items[i]);
   printf("Creator(s):\n   ");
-  DumpList(opf->metadata->creator, (ListDumpFunc)_list_dump_creator);
+  for (i = 0; i < meta->creator.count; i++)
+    _list_dump_creator(&meta->creator.items[i]);
   printf("Identifier(s):\n   ");
-  DumpList(opf->metadata->id, (ListDumpFunc)_list_dump_id);
+  for (i = 0; i < meta->id.count; i++)
+    _list_dump_id(&meta->id.items[i]);
   printf("Reading order:\n");
-  DumpList(opf->spine, (ListDumpFunc)_list_dump_spine);
+  for (i = 0; opf->spine && i < opf->spine->count; i++)
+    _list_dump_spine(&opf->spine->items[i]);
   printf("\n");
   if (opf->guide) {
     printf("Guide:\n");
-    DumpList(opf->guide, (ListDumpFunc)_list_dump_guide);
+    for (i = 0; i < opf->guide->count; i++)
+      _list_dump_guide(&opf->guide->items[i]);
   }
-  if (opf->tours)
-    DumpList(opf->tours, (ListDumpFunc)_list_dump_tour);
-  if (opf->metadata->meta->Size != 0) {
+  for (i = 0; opf->tours && i < opf->tours->count; i++)
+    _list_dump_tour(&opf->tours->items[i]);
+  if (meta->meta.count != 0) {
     printf("Extra local metadata:\n");
-    DumpList(opf->metadata->meta, (ListDumpFunc)_list_dump_meta);
+    for (i = 0; i < meta->meta.count; i++)
+      _list_dump_meta(&meta->meta.items[i]);
   }
 }
 
+// The structures are in the arena of the epub, released by epub_close
 void _opf_close(struct opf *opf) {
-  if (opf->metadata)
-    _opf_free_metadata(opf->metadata);
-  if (opf->toc)
-    _opf_free_toc(opf->toc);
-  if (opf->spine)
-    FreeList(opf->spine, (ListFreeFunc)_list_free_spine);
-  if (opf->tocName)
-    free(opf->tocName);
-  if (opf->manifest)
-    FreeList(opf->manifest, (ListFreeFunc)_list_free_manifest);
-  if (opf->guide)
-    FreeList(opf->guide, (ListFreeFunc)_list_free_guide);
-  if (opf->tours)
-    FreeList(opf->tours, (ListFreeFunc)_list_free_tours);
-  free(opf);
+  _opf_toc_free(opf->tocLoad);
+  hash_free(opf->manifestById);
+  hash_free(opf->manifestByPath);
+  free(opf->manifest);
 }
@@ -0,0 +1,973 @@
+#include "epublib.h"
+#include "url.h"
+
+#include <libxml/parserInternals.h>
+
+// Parsing of the package and toc documents through SAX2 callbacks
+// (EPUB_OPEN_SAX). libxml hands the attributes of an element over in one
+// array, so they are all taken in a single pass instead of one reader
+// lookup each. The records are filled like the reader based parsers of
+// opf.c do, through the same helpers. The text of an element is only
+// known once it ends, so the elements whose text is needed stay on a
+// stack until then.
+
+// Parts of the package
+enum {
+  SAX_PACKAGE,
+  SAX_METADATA,
+  SAX_MANIFEST,
+  SAX_SPINE,
+  SAX_GUIDE,
+  SAX_TOURS
+};
+
+// An open element whose text is collected
+struct sax_open {
+  enum opf_element element;
+  const xmlChar *localName;
+  int text; // start of its text in sax->text
+  int children; // bool, it has child nodes
+  int mixed; // bool, not only text
+  xmlChar *values[OPF_METADATA_VALUES]; // see _opf_add_metadata
+};
+
+struct opf_sax {
+  struct opf *opf;
+  struct epub *epub;
+  xmlParserCtxtPtr ctxt;
+  int failed; // bool, out of memory
+  int stopped; // bool, the rest of the document isn't needed
+  int depth; // of the current element
+
+  // package
+  int part; // SAX_*
+  int partDepth;
+  struct tour *tour; // tour being read
+  int tourDepth;
+
+  // toc
+  struct tocCategory *tc; // category being read
+  enum opf_element category;
+  int categoryDepth;
+  struct tocItem cur, *item; // the item being parsed
+  int itemDepth; // nav point nesting
+  struct tocLabel label; // navLabel or navInfo being read
+  enum opf_element labelElement; // OPF_ELEMENT_OTHER outside of labels
+  int labelDepth;
+
+  // open elements and their text
+  struct sax_open *open;
+  int openCount, openAlloc;
+  char *text;
+  int textLen, textAlloc;
+  char *scratch; // null terminated attribute value
+  int scratchAlloc;
+};
+
+// Returns the state of the parser calling back, NULL for the parsers of
+// entity contents, whose nodes the reader doesn't visit either
+static struct opf_sax *_opf_sax_get(void *ctx)
+{
+  xmlParserCtxtPtr ctxt = ctx;
+  struct opf_sax *sax = ctxt->_private;
+
+  return sax && sax->ctxt == ctxt ? sax : NULL;
+}
+
+static void _opf_sax_oom(struct opf_sax *sax)
+{
+  _epub_err_set_oom(&sax->epub->error);
+  sax->failed = 1;
+  xmlStopParser(sax->ctxt);
+}
+
+// Makes sure buf holds size bytes. Returns -1 on failure
+static int _opf_sax_reserve(struct opf_sax *sax, char **buf, int *alloc,
+                            int size)
+{
+  char *tmp;
+  int n = *alloc ? *alloc : 256;
+
+  if (size <= *alloc)
+    return 0;
+
+  while (n < size)
+    n *= 2;
+  if (!(tmp = realloc(*buf, n))) {
+    _opf_sax_oom(sax);
+    return -1;
+  }
+  *buf = tmp;
+  *alloc = n;
+
+  return 0;
+}
+
+// Returns the value of attr (localname, prefix, URI, value, end) null
+// terminated in the scratch buffer or NULL on failure
+static char *_opf_sax_scratch(struct opf_sax *sax, const xmlChar **attr)
+{
+  int len = attr[4] - attr[3];
+  xmlChar *decoded;
+
+  // entities are left in values for the tree, it decodes them like this
+  if (memchr(attr[3], '&', len)) {
+    decoded = xmlStringLenDecodeEntities(sax->ctxt, attr[3], len,
+                                         XML_SUBSTITUTE_REF, 0, 0, 0);
+    if (!decoded) {
+      _opf_sax_oom(sax);
+      return NULL;
+    }
+    len = xmlStrlen(decoded);
+    if (!_opf_sax_reserve(sax, &sax->scratch, &sax->scratchAlloc, len + 1))
+      memcpy(sax->scratch, decoded, len + 1);
+    xmlFree(decoded);
+    return sax->failed ? NULL : sax->scratch;
+  }
+
+  if (_opf_sax_reserve(sax, &sax->scratch, &sax->scratchAlloc, len + 1))
+    return NULL;
+  memcpy(sax->scratch, attr[3], len);
+  sax->scratch[len] = 0;
+
+  return sax->scratch;
+}
+
+// Returns a copy of the value of attr in the book's strings
+static xmlChar *_opf_sax_value(struct opf_sax *sax, const xmlChar **attr)
+{
+  char *value = _opf_sax_scratch(sax, attr);
+
+  return value ? (xmlChar *)strpool_strdup(sax->epub->strings, value) : NULL;
+}
+
+// Like _opf_sax_value but returns the offset in the book's strings
+static uint32_t _opf_sax_offset(struct opf_sax *sax, const xmlChar **attr)
+{
+  return strpool_offset(sax->epub->strings,
+                        (char *)_opf_sax_value(sax, attr));
+}
+
+// Returns the value of attr interned, see _epub_intern
+static xmlChar *_opf_sax_interned(struct opf_sax *sax, const xmlChar **attr)
+{
+  char *value = _opf_sax_scratch(sax, attr);
+
+  return value ? _epub_intern(sax->epub, (xmlChar *)value) : NULL;
+}
+
+// Returns the value of attr as an int like _get_attribute_as_positive_int
+static int _opf_sax_int(struct opf_sax *sax, const xmlChar **attr)
+{
+  char *value = _opf_sax_scratch(sax, attr);
+
+  return value ? atoi(value) : -1;
+}
+
+// Returns whether attr is the attribute name without a prefix, the only
+// ones the reader's attribute lookups find
+static int _opf_sax_is(const xmlChar **attr, const char *name)
+{
+  return !attr[1] && !xmlStrcmp(attr[0], (const xmlChar *)name);
+}
+
+// Notes a child node of the innermost open element
+static void _opf_sax_child(struct opf_sax *sax, int mixed)
+{
+  struct sax_open *open;
+
+  if (!sax->openCount)
+    return;
+
+  open = &sax->open[sax->openCount - 1];
+  open->children = 1;
+  if (mixed)
+    open->mixed = 1;
+}
+
+// Starts collecting the text of the element started last. Returns NULL
+// on failure
+static struct sax_open *_opf_sax_push(struct opf_sax *sax,
+                                      enum opf_element element,
+                                      const xmlChar *localName)
+{
+  struct sax_open *open;
+
+  if (sax->openCount == sax->openAlloc) {
+    open = realloc(sax->open, (sax->openAlloc ? sax->openAlloc * 2 : 8) *
+                   sizeof(struct sax_open));
+    if (!open) {
+      _opf_sax_oom(sax);
+      return NULL;
+    }
+    sax->open = open;
+    sax->openAlloc = sax->openAlloc ? sax->openAlloc * 2 : 8;
+  }
+
+  open = &sax->open[sax->openCount++];
+  memset(open, 0, sizeof(struct sax_open));
+  open->element = element;
+  open->localName = localName;
+  open->text = sax->textLen;
+
+  return open;
+}
+
+// Returns a copy of the text of the innermost open element, which ends,
+// like _epub_xml_string does: NULL without child nodes
+static xmlChar *_opf_sax_text(struct opf_sax *sax, struct sax_open *open)
+{
+  if (!open->children)
+    return NULL;
+
+  if (_opf_sax_reserve(sax, &sax->text, &sax->textAlloc, sax->textLen + 1))
+    return NULL;
+  sax->text[sax->textLen] = 0;
+
+  return (xmlChar *)strpool_strdup(sax->epub->strings,
+                                   sax->text + open->text);
+}
+
+// Stops collecting the text of the innermost open element
+static void _opf_sax_pop(struct opf_sax *sax)
+{
+  // the outermost element's text holds all the others'
+  if (!--sax->openCount)
+    sax->textLen = 0;
+}
+
+static void _opf_sax_characters(void *ctx, const xmlChar *ch, int len)
+{
+  struct opf_sax *sax = _opf_sax_get(ctx);
+
+  if (!sax || !sax->openCount)
+    return;
+
+  _opf_sax_child(sax, 0);
+  if (_opf_sax_reserve(sax, &sax->text, &sax->textAlloc,
+                       sax->textLen + len + 1))
+    return;
+  memcpy(sax->text + sax->textLen, ch, len);
+  sax->textLen += len;
+}
+
+static void _opf_sax_cdata(void *ctx, const xmlChar *value, int len)
+{
+  struct opf_sax *sax = _opf_sax_get(ctx);
+
+  if (!sax)
+    return;
+  _opf_sax_characters(ctx, value, len);
+  _opf_sax_child(sax, 1);
+}
+
+// Comments, processing instructions and entity references
+static void _opf_sax_comment(void *ctx, const xmlChar *value)
+{
+  struct opf_sax *sax = _opf_sax_get(ctx);
+
+  (void)value;
+  if (sax)
+    _opf_sax_child(sax, 1);
+}
+
+static void _opf_sax_pi(void *ctx, const xmlChar *target,
+                        const xmlChar *data)
+{
+  struct opf_sax *sax = _opf_sax_get(ctx);
+
+  (void)target;
+  (void)data;
+  if (sax)
+    _opf_sax_child(sax, 1);
+}
+
+// Package
+
+static void _opf_sax_begin_part(struct opf_sax *sax, const xmlChar *localName,
+                                int nbAttrs, const xmlChar **attrs)
+{
+  struct opf *opf = sax->opf;
+  int i;
+
+  if (!xmlStrcmp(localName, (xmlChar *)"metadata")) {
+    _epub_print_debug(sax->epub, DEBUG_INFO, "parsing metadata");
+    _opf_init_metadata(opf);
+    sax->part = SAX_METADATA;
+  } else if (!xmlStrcmp(localName, (xmlChar *)"manifest")) {
+    _epub_print_debug(sax->epub, DEBUG_INFO, "parsing manifest");
+    _opf_begin_manifest(opf);
+    sax->part = SAX_MANIFEST;
+  } else if (!xmlStrcmp(localName, (xmlChar *)"spine")) {
+    _epub_print_debug(sax->epub, DEBUG_INFO, "parsing spine");
+    sax->part = SAX_SPINE;
+    opf->spine = arena_zalloc(sax->epub->arena, sizeof(*opf->spine));
+    if (!opf->spine) {
+      _epub_err_set_oom(&sax->epub->error);
+      return;
+    }
+
+    opf->tocName = NULL;
+    for (i = 0; i < nbAttrs; i++, attrs += 5) {
+      if (_opf_sax_is(attrs, "toc"))
+        opf->tocName = _opf_sax_value(sax, attrs);
+    }
+
+    // the toc is parsed on first use, see _opf_load_toc, or alongside
+    // the rest of the package, see _opf_toc_start
+    if (opf->tocName) {
+      _epub_print_debug(sax->epub, DEBUG_INFO, "toc is %s", opf->tocName);
+      _opf_toc_start(opf);
+    } else {
+      _epub_print_debug(sax->epub, DEBUG_WARNING, "toc not found (-)");
+    }
+  } else if (!xmlStrcmp(localName, (xmlChar *)"guide")) {
+    _epub_print_debug(sax->epub, DEBUG_INFO, "parsing guides");
+    sax->part = SAX_GUIDE;
+    if (!(opf->guide = arena_zalloc(sax->epub->arena, sizeof(*opf->guide))))
+      _epub_err_set_oom(&sax->epub->error);
+  } else if (!xmlStrcmp(localName, (xmlChar *)"tours")) {
+    _epub_print_debug(sax->epub, DEBUG_INFO, "parsing tours");
+    sax->part = SAX_TOURS;
+    sax->tour = NULL;
+    if (!(opf->tours = arena_zalloc(sax->epub->arena, sizeof(*opf->tours))))
+      _epub_err_set_oom(&sax->epub->error);
+  } else {
+    return;
+  }
+
+  sax->partDepth = sax->depth;
+}
+
+static void _opf_sax_metadata(struct opf_sax *sax, const xmlChar *localName,
+                              int nbAttrs, const xmlChar **attrs)
+{
+  enum opf_element element = _opf_element(localName);
+  struct sax_open *open;
+  int i, opf, value;
+
+  if (!(open = _opf_sax_push(sax, element, localName)))
+    return;
+
+  for (i = 0; i < nbAttrs; i++, attrs += 5) {
+    // opf:scheme and the like win over scheme
+    opf = attrs[1] && !xmlStrcmp(attrs[1], (xmlChar *)"opf");
+    if (attrs[1] && !opf)
+      continue;
+
+    value = -1;
+    switch (element) {
+    case OPF_ELEMENT_IDENTIFIER:
+      if (!xmlStrcmp(attrs[0], (xmlChar *)"scheme"))
+        value = 0;
+      else if (!opf && !xmlStrcmp(attrs[0], (xmlChar *)"id"))
+        value = 1;
+      break;
+    case OPF_ELEMENT_CREATOR:
+    case OPF_ELEMENT_CONTRIBUTOR:
+      if (!xmlStrcmp(attrs[0], (xmlChar *)"file-as"))
+        value = 0;
+      else if (!xmlStrcmp(attrs[0], (xmlChar *)"role"))
+        value = 1;
+      break;
+    case OPF_ELEMENT_META:
+      if (opf)
+        break;
+      if (!xmlStrcmp(attrs[0], (xmlChar *)"name"))
+        value = 0;
+      else if (!xmlStrcmp(attrs[0], (xmlChar *)"content"))
+        value = 1;
+      else if (!xmlStrcmp(attrs[0], (xmlChar *)"property"))
+        value = 2;
+      break;
+    case OPF_ELEMENT_DATE:
+      if (!xmlStrcmp(attrs[0], (xmlChar *)"event"))
+        value = 0;
+      break;
+    default:
+      break;
+    }
+
+    if (value != -1 && (opf || !open->values[value]))
+      open->values[value] = _opf_sax_value(sax, attrs);
+  }
+}
+
+static void _opf_sax_manifest(struct opf_sax *sax, int nbAttrs,
+                              const xmlChar **attrs)
+{
+  struct manifest *item;
+  int i;
+
+  if (!(item = _opf_add_manifest_item(sax->opf)))
+    return;
+
+  for (i = 0; i < nbAttrs; i++, attrs += 5) {
+    if (attrs[1])
+      continue;
+
+    if (_opf_sax_is(attrs, "id"))
+      item->id = _opf_sax_offset(sax, attrs);
+    else if (_opf_sax_is(attrs, "href"))
+      item->href = _opf_sax_offset(sax, attrs);
+    else if (_opf_sax_is(attrs, "media-type"))
+      item->type = strpool_offset(sax->epub->strings,
+                                  (char *)_opf_sax_interned(sax, attrs));
+    else if (_opf_sax_is(attrs, "fallback"))
+      item->fallback = _opf_sax_offset(sax, attrs);
+    else if (_opf_sax_is(attrs, "fallback-style"))
+      item->fbStyle = _opf_sax_offset(sax, attrs);
+    else if (_opf_sax_is(attrs, "required-namespace"))
+      item->nspace = _opf_sax_offset(sax, attrs);
+    else if (_opf_sax_is(attrs, "required-modules"))
+      item->modules = _opf_sax_offset(sax, attrs);
+  }
+
+  _opf_resolve_manifest_item(sax->opf, item);
+}
+
+static void _opf_sax_spine(struct opf_sax *sax, int nbAttrs,
+                           const xmlChar **attrs)
+{
+  struct spine *item;
+  xmlChar *linear = NULL, *properties = NULL;
+  int i;
+
+  if (!sax->opf->spine || !(item = VECTOR_PUSH(sax->epub, *sax->opf->spine)))
+    return;
+
+  for (i = 0; i < nbAttrs; i++, attrs += 5) {
+    if (_opf_sax_is(attrs, "idref"))
+      item->idref = _opf_sax_value(sax, attrs);
+    else if (_opf_sax_is(attrs, "linear"))
+      linear = xmlStrdup((xmlChar *)_opf_sax_scratch(sax, attrs));
+    else if (_opf_sax_is(attrs, "properties"))
+      properties = xmlStrdup((xmlChar *)_opf_sax_scratch(sax, attrs));
+  }
+
+  _opf_set_spine_properties(sax->opf, item, linear, properties);
+  xmlFree(linear);
+  xmlFree(properties);
+
+  _epub_print_debug(sax->epub, DEBUG_INFO, "found item %s", item->idref);
+}
+
+static void _opf_sax_guide(struct opf_sax *sax, int nbAttrs,
+                           const xmlChar **attrs)
+{
+  struct guide *item;
+  int i;
+
+  if (!sax->opf->guide || !(item = VECTOR_PUSH(sax->epub, *sax->opf->guide)))
+    return;
+
+  for (i = 0; i < nbAttrs; i++, attrs += 5) {
+    if (_opf_sax_is(attrs, "type"))
+      item->type = _opf_sax_value(sax, attrs);
+    else if (_opf_sax_is(attrs, "title"))
+      item->title = _opf_sax_value(sax, attrs);
+    else if (_opf_sax_is(attrs, "href"))
+      item->href = _opf_sax_value(sax, attrs);
+  }
+
+  _epub_print_debug(sax->epub, DEBUG_INFO,
+                    "guide item: %s href: %s type: %s",
+                    item->title, item->href, item->type);
+}
+
+// The elements of tours are tours, theirs are sites
+static void _opf_sax_tours(struct opf_sax *sax, int nbAttrs,
+                           const xmlChar **attrs)
+{
+  struct tour *tour;
+  struct site *site;
+  int i;
+
+  if (!sax->opf->tours)
+    return;
+
+  if (sax->tour) {
+    if (!(site = VECTOR_PUSH(sax->epub, sax->tour->sites)))
+      return;
+
+    for (i = 0; i < nbAttrs; i++, attrs += 5) {
+      if (_opf_sax_is(attrs, "title"))
+        site->title = _opf_sax_value(sax, attrs);
+      else if (_opf_sax_is(attrs, "href"))
+        site->href = _opf_sax_value(sax, attrs);
+    }
+    _epub_print_debug(sax->epub, DEBUG_INFO, "site: %s href: %s",
+                      site->title, site->href);
+    return;
+  }
+
+  if (!(tour = VECTOR_PUSH(sax->epub, *sax->opf->tours)))
+    return;
+  for (i = 0; i < nbAttrs; i++, attrs += 5) {
+    if (_opf_sax_is(attrs, "title"))
+      tour->title = _opf_sax_value(sax, attrs);
+    else if (_opf_sax_is(attrs, "id"))
+      tour->id = _opf_sax_value(sax, attrs);
+  }
+  _epub_print_debug(sax->epub, DEBUG_INFO, "tour: %s id: %s",
+                    tour->title, tour->id);
+
+  sax->tour = tour;
+  sax->tourDepth = sax->depth;
+}
+
+static void _opf_sax_package_start(void *ctx, const xmlChar *localName,
+                                   const xmlChar *prefix, const xmlChar *URI,
+                                   int nbNamespaces, const xmlChar **namespaces,
+                                   int nbAttrs, int nbDefaulted,
+                                   const xmlChar **attrs)
+{
+  struct opf_sax *sax = _opf_sax_get(ctx);
+
+  (void)prefix;
+  (void)URI;
+  (void)nbNamespaces;
+  (void)namespaces;
+  (void)nbDefaulted;
+
+  if (!sax)
+    return;
+
+  _opf_sax_child(sax, 1);
+  sax->depth++;
+
+  switch (sax->part) {
+  case SAX_PACKAGE:
+    _opf_sax_begin_part(sax, localName, nbAttrs, attrs);
+    break;
+  case SAX_METADATA:
+    _opf_sax_metadata(sax, localName, nbAttrs, attrs);
+    break;
+  case SAX_MANIFEST:
+    _opf_sax_manifest(sax, nbAttrs, attrs);
+    break;
+  case SAX_SPINE:
+    _opf_sax_spine(sax, nbAttrs, attrs);
+    break;
+  case SAX_GUIDE:
+    _opf_sax_guide(sax, nbAttrs, attrs);
+    break;
+  case SAX_TOURS:
+    _opf_sax_tours(sax, nbAttrs, attrs);
+    break;
+  }
+}
+
+static void _opf_sax_package_end(void *ctx, const xmlChar *localName,
+                                 const xmlChar *prefix, const xmlChar *URI)
+{
+  struct opf_sax *sax = _opf_sax_get(ctx);
+  struct sax_open *open;
+
+  (void)localName;
+  (void)prefix;
+  (void)URI;
+
+  if (!sax)
+    return;
+
+  if (sax->part == SAX_METADATA && sax->depth > sax->partDepth &&
+      sax->openCount) {
+    open = &sax->open[sax->openCount - 1];
+    _opf_add_metadata(sax->opf, open->element, open->localName,
+                      _opf_sax_text(sax, open), open->values);
+    _opf_sax_pop(sax);
+  }
+
+  if (sax->part == SAX_TOURS && sax->tour && sax->depth == sax->tourDepth)
+    sax->tour = NULL;
+
+  if (sax->part != SAX_PACKAGE && sax->depth == sax->partDepth) {
+    if (sax->part == SAX_MANIFEST)
+      _opf_index_manifest(sax->opf);
+
+    // the rest of the package isn't needed
+    if (sax->part == SAX_METADATA &&
+        (sax->epub->flags & EPUB_OPEN_METADATA_ONLY)) {
+      sax->stopped = 1;
+      xmlStopParser(sax->ctxt);
+    }
+
+    sax->part = SAX_PACKAGE;
+  }
+
+  sax->depth--;
+}
+
+// Toc
+
+// Returns the element of the toc named localName with prefix
+static enum opf_element _opf_sax_toc_element(const xmlChar *localName,
+                                             const xmlChar *prefix)
+{
+  // the toc elements are matched with their qualified names
+  return prefix ? OPF_ELEMENT_OTHER : _opf_element(localName);
+}
+
+static void _opf_sax_begin_category(struct opf_sax *sax,
+                                    enum opf_element element, int nbAttrs,
+                                    const xmlChar **attrs)
+{
+  struct tocCategory *tc;
+  int i;
+
+  sax->category = element;
+  sax->categoryDepth = sax->depth;
+  sax->item = NULL;
+  sax->itemDepth = 0;
+
+  if (!(tc = sax->tc = _opf_init_toc_category(sax->opf)))
+    return;
+
+  if (element == OPF_ELEMENT_NAVMAP)
+    _epub_print_debug(sax->epub, DEBUG_INFO, "parsing nav map");
+
+  for (i = 0; i < nbAttrs; i++, attrs += 5) {
+    if (_opf_sax_is(attrs, "id"))
+      tc->id = _opf_sax_value(sax, attrs);
+    else if (_opf_sax_is(attrs, "class") && element != OPF_ELEMENT_NAVMAP)
+      tc->class = _opf_sax_interned(sax, attrs);
+  }
+
+  if (element == OPF_ELEMENT_NAVLIST)
+    _epub_print_debug(sax->epub, DEBUG_INFO, "parsing nav list");
+  else if (element == OPF_ELEMENT_PAGELIST)
+    _epub_print_debug(sax->epub, DEBUG_INFO, "parsing page list");
+}
+
+static void _opf_sax_end_category(struct opf_sax *sax)
+{
+  struct toc *toc = sax->opf->toc;
+
+  switch (sax->category) {
+  case OPF_ELEMENT_NAVMAP:
+    toc->navMap = sax->tc;
+    _epub_print_debug(sax->epub, DEBUG_INFO, "finished parsing nav map");
+    break;
+  case OPF_ELEMENT_NAVLIST:
+    toc->navList = sax->tc;
+    _epub_print_debug(sax->epub, DEBUG_INFO, "finished parsing nav list");
+    break;
+  default:
+    toc->pageList = sax->tc;
+    _epub_print_debug(sax->epub, DEBUG_INFO, "finished parsing page list");
+    break;
+  }
+
+  sax->tc = NULL;
+  sax->category = OPF_ELEMENT_OTHER;
+}
+
+// Names the items of the category being read in messages
+static const char *_opf_sax_item_kind(struct opf_sax *sax)
+{
+  switch (sax->category) {
+  case OPF_ELEMENT_NAVMAP:
+    return "nav point";
+  case OPF_ELEMENT_NAVLIST:
+    return "nav target";
+  default:
+    return "page target";
+  }
+}
+
+// Adds the item being parsed to the category
+static void _opf_sax_add_item(struct opf_sax *sax)
+{
+  struct tocItem *item = sax->item;
+
+  _epub_print_debug(sax->epub, DEBUG_INFO,
+                    "adding %s item->%s %s (d:%d,p:%d)",
+                    _opf_sax_item_kind(sax),
+                    _epub_str(sax->epub, item->id),
+                    _epub_str(sax->epub, item->src),
+                    item->depth, item->playOrder);
+  VECTOR_ADD(sax->epub, sax->tc->items, *item);
+  sax->item = NULL;
+}
+
+static void _opf_sax_begin_item(struct opf_sax *sax, int nbAttrs,
+                                const xmlChar **attrs)
+{
+  struct tocItem *item;
+  int i;
+
+  if (sax->category == OPF_ELEMENT_NAVMAP) {
+    if (sax->item)
+      _opf_sax_add_item(sax);
+    sax->itemDepth++;
+  }
+
+  item = sax->item = &sax->cur;
+  _opf_init_toc_item(item, sax->category == OPF_ELEMENT_NAVMAP ?
+                     sax->itemDepth : 1);
+
+  for (i = 0; i < nbAttrs; i++, attrs += 5) {
+    if (_opf_sax_is(attrs, "id"))
+      item->id = _opf_sax_offset(sax, attrs);
+    else if (_opf_sax_is(attrs, "class"))
+      item->class = strpool_offset(sax->epub->strings,
+                                   (char *)_opf_sax_interned(sax, attrs));
+    else if (_opf_sax_is(attrs, "type") &&
+             sax->category == OPF_ELEMENT_PAGELIST)
+      item->type = strpool_offset(sax->epub->strings,
+                                  (char *)_opf_sax_interned(sax, attrs));
+    else if (_opf_sax_is(attrs, "playOrder"))
+      item->playOrder = _opf_sax_int(sax, attrs);
+    else if (_opf_sax_is(attrs, "value") &&
+             sax->category != OPF_ELEMENT_NAVMAP)
+      item->value = _opf_sax_int(sax, attrs);
+  }
+
+  if (item->playOrder == -1)
+    _epub_print_debug(sax->epub, DEBUG_WARNING,
+                      "- missing play order in %s element",
+                      _opf_sax_item_kind(sax));
+}
+
+static void _opf_sax_end_item(struct opf_sax *sax)
+{
+  if (sax->item)
+    _opf_sax_add_item(sax);
+  else if (sax->category != OPF_ELEMENT_NAVMAP)
+    _epub_print_debug(sax->epub, DEBUG_ERROR, "empty item in nav list");
+
+  if (sax->category == OPF_ELEMENT_NAVMAP)
+    sax->itemDepth--;
+}
+
+// navLabel, navInfo, text and content elements of a category
+static void _opf_sax_category_child(struct opf_sax *sax,
+                                    enum opf_element element,
+                                    const xmlChar *localName, int nbAttrs,
+                                    const xmlChar **attrs)
+{
+  struct tocItem *item = sax->item;
+  xmlChar *xmlLang = NULL;
+  char *src;
+  int i;
+
+  switch (element) {
+  case OPF_ELEMENT_NAVLABEL:
+  case OPF_ELEMENT_NAVINFO:
+    if (sax->labelElement != OPF_ELEMENT_OTHER)
+      break;
+
+    memset(&sax->label, 0, sizeof(struct tocLabel));
+    for (i = 0; i < nbAttrs; i++, attrs += 5) {
+      // xml:lang wins over a plain lang, like in _opf_parse_navlabel
+      if (attrs[1] && !xmlStrcmp(attrs[1], (const xmlChar *)"xml") &&
+          !xmlStrcmp(attrs[0], (const xmlChar *)"lang"))
+        xmlLang = _opf_sax_interned(sax, attrs);
+      else if (_opf_sax_is(attrs, "lang"))
+        sax->label.lang = _opf_sax_interned(sax, attrs);
+      else if (_opf_sax_is(attrs, "dir"))
+        sax->label.dir = _opf_sax_interned(sax, attrs);
+    }
+    if (xmlLang)
+      sax->label.lang = xmlLang;
+    sax->labelElement = element;
+    sax->labelDepth = sax->depth;
+    break;
+
+  case OPF_ELEMENT_TEXT:
+    if (sax->labelElement != OPF_ELEMENT_OTHER)
+      _opf_sax_push(sax, element, localName);
+    break;
+
+  case OPF_ELEMENT_CONTENT:
+    if (!item) {
+      _epub_print_debug(sax->epub, DEBUG_WARNING,
+                        "content not inside %s element",
+                        _opf_sax_item_kind(sax));
+      break;
+    }
+
+    for (i = 0; i < nbAttrs; i++, attrs += 5) {
+      if (_opf_sax_is(attrs, "src"))
+        item->src = _opf_sax_offset(sax, attrs);
+    }
+    src = (char *)_epub_str(sax->epub, item->src);
+    if (src)
+      url_decode(src, strlen(src));
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void _opf_sax_end_label(struct opf_sax *sax)
+{
+  int info = sax->labelElement == OPF_ELEMENT_NAVINFO;
+
+  _opf_add_label(sax->opf, sax->tc, info ? NULL : sax->item, info,
+                 &sax->label);
+  if (info && sax->item)
+    _epub_print_debug(sax->epub, DEBUG_WARNING,
+                      "nav info inside %s element", _opf_sax_item_kind(sax));
+
+  sax->labelElement = OPF_ELEMENT_OTHER;
+}
+
+static void _opf_sax_toc_start(void *ctx, const xmlChar *localName,
+                               const xmlChar *prefix, const xmlChar *URI,
+                               int nbNamespaces, const xmlChar **namespaces,
+                               int nbAttrs, int nbDefaulted,
+                               const xmlChar **attrs)
+{
+  struct opf_sax *sax = _opf_sax_get(ctx);
+  enum opf_element element = _opf_sax_toc_element(localName, prefix);
+
+  (void)URI;
+  (void)nbNamespaces;
+  (void)namespaces;
+  (void)nbDefaulted;
+
+  if (!sax)
+    return;
+
+  _opf_sax_child(sax, 1);
+  sax->depth++;
+
+  if (sax->category == OPF_ELEMENT_OTHER) {
+    if (element == OPF_ELEMENT_NAVMAP || element == OPF_ELEMENT_NAVLIST ||
+        element == OPF_ELEMENT_PAGELIST)
+      _opf_sax_begin_category(sax, element, nbAttrs, attrs);
+    return;
+  }
+
+  if (!sax->tc)
+    return;
+
+  if ((sax->category == OPF_ELEMENT_NAVMAP &&
+       element == OPF_ELEMENT_NAVPOINT) ||
+      (sax->category == OPF_ELEMENT_NAVLIST &&
+       element == OPF_ELEMENT_NAVTARGET) ||
+      (sax->category == OPF_ELEMENT_PAGELIST &&
+       element == OPF_ELEMENT_PAGETARGET))
+    _opf_sax_begin_item(sax, nbAttrs, attrs);
+  else
+    _opf_sax_category_child(sax, element, localName, nbAttrs, attrs);
+}
+
+static void _opf_sax_toc_end(void *ctx, const xmlChar *localName,
+                             const xmlChar *prefix, const xmlChar *URI)
+{
+  struct opf_sax *sax = _opf_sax_get(ctx);
+  enum opf_element element = _opf_sax_toc_element(localName, prefix);
+  struct sax_open *open;
+
+  (void)URI;
+
+  if (!sax)
+    return;
+
+  if (sax->category != OPF_ELEMENT_OTHER && sax->tc) {
+    if (element == OPF_ELEMENT_TEXT && sax->openCount) {
+      open = &sax->open[sax->openCount - 1];
+      sax->label.text = _opf_sax_text(sax, open);
+      _opf_sax_pop(sax);
+    } else if (sax->labelElement != OPF_ELEMENT_OTHER &&
+               sax->depth == sax->labelDepth) {
+      _opf_sax_end_label(sax);
+    } else if ((sax->category == OPF_ELEMENT_NAVMAP &&
+                element == OPF_ELEMENT_NAVPOINT) ||
+               (sax->category == OPF_ELEMENT_NAVLIST &&
+                element == OPF_ELEMENT_NAVTARGET) ||
+               (sax->category == OPF_ELEMENT_PAGELIST &&
+                element == OPF_ELEMENT_PAGETARGET)) {
+      _opf_sax_end_item(sax);
+    }
+  }
+
+  if (sax->category != OPF_ELEMENT_OTHER &&
+      sax->depth == sax->categoryDepth)
+    _opf_sax_end_category(sax);
+
+  sax->depth--;
+}
+
+// Parses doc with the element callbacks start and end. Returns -1 if it
+// can't be parsed
+static int _opf_sax_parse(struct opf_sax *sax, const char *doc, int size,
+                          const char *name,
+                          startElementNsSAX2Func start,
+                          endElementNsSAX2Func end)
+{
+  xmlSAXHandler handler;
+  int ret = 0;
+
+  // the defaults keep the declarations of the document, entities are
+  // resolved like the reader does
+  xmlSAXVersion(&handler, 2);
+  handler.startElementNs = start;
+  handler.endElementNs = end;
+  handler.characters = _opf_sax_characters;
+  handler.ignorableWhitespace = _opf_sax_characters;
+  handler.cdataBlock = _opf_sax_cdata;
+  handler.comment = _opf_sax_comment;
+  handler.processingInstruction = _opf_sax_pi;
+  handler.reference = _opf_sax_comment;
+
+  sax->ctxt = xmlCreateMemoryParserCtxt(doc, size);
+  if (!sax->ctxt) {
+    _epub_err_set_oom(&sax->epub->error);
+    return -1;
+  }
+  memcpy(sax->ctxt->sax, &handler, sizeof(xmlSAXHandler));
+  sax->ctxt->_private = sax;
+  // messages name the document like the reader's
+  if (!sax->ctxt->input->filename)
+    sax->ctxt->input->filename = (char *)xmlStrdup((const xmlChar *)name);
+
+  xmlParseDocument(sax->ctxt);
+  if (sax->failed || (!sax->stopped && !sax->ctxt->wellFormed))
+    ret = -1;
+
+  xmlFreeDoc(sax->ctxt->myDoc);
+  xmlFreeParserCtxt(sax->ctxt);
+  free(sax->open);
+  free(sax->text);
+  free(sax->scratch);
+
+  return ret;
+}
+
+int _opf_sax_package(struct opf *opf, const char *opfStr, int size)
+{
+  struct opf_sax sax;
+
+  memset(&sax, 0, sizeof(struct opf_sax));
+  sax.opf = opf;
+  sax.epub = opf->epub;
+  sax.part = SAX_PACKAGE;
+
+  if (_opf_sax_parse(&sax, opfStr, size, "OPF", _opf_sax_package_start,
+                     _opf_sax_package_end) == -1) {
+    _epub_print_debug(opf->epub, DEBUG_ERROR, "failed to parse OPF");
+    return -1;
+  }
+
+  return 0;
+}
+
+void _opf_sax_toc(struct opf *opf, const char *tocStr, int size)
+{
+  struct opf_sax sax;
+
+  memset(&sax, 0, sizeof(struct opf_sax));
+  sax.opf = opf;
+  sax.epub = opf->epub;
+  sax.category = OPF_ELEMENT_OTHER;
+  sax.labelElement = OPF_ELEMENT_OTHER;
+
+  if (_opf_sax_parse(&sax, tocStr, size, "TOC", _opf_sax_toc_start,
+                     _opf_sax_toc_end) == -1)
+    _epub_print_debug(opf->epub, DEBUG_ERROR, "failed to parse toc");
+}
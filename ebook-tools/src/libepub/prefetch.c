@@ -0,0 +1,248 @@
+#include "epublib.h"
+
+// Background inflation of the spine items following an iterator.
+// The worker thread reads through its own archive handle, since libzip
+// handles can't be shared between threads, and hands finished blobs
+// over to the iterator under the prefetch lock.
+
+#ifndef _WIN32
+
+enum {
+  PREFETCH_EMPTY,
+  PREFETCH_QUEUED, // waiting for the worker
+  PREFETCH_BUSY, // being inflated by the worker
+  PREFETCH_READY // blob is ready to be taken
+};
+
+void *_epub_prefetch_worker(void *arg) {
+  struct eprefetch *pf = arg;
+  struct eprefetch_slot *slot;
+  zip_int64_t index;
+  char *data;
+  int i, size;
+
+  pthread_mutex_lock(&pf->lock);
+  while (! pf->stop) {
+    // take the queued item closest to the reader
+    slot = NULL;
+    for (i = 0; i < pf->count; i++) {
+      if (pf->slots[i].state == PREFETCH_QUEUED &&
+          (! slot || pf->slots[i].order < slot->order))
+        slot = &pf->slots[i];
+    }
+
+    if (! slot) {
+      pthread_cond_wait(&pf->cond, &pf->lock);
+      continue;
+    }
+
+    slot->state = PREFETCH_BUSY;
+    index = slot->index;
+    pthread_mutex_unlock(&pf->lock);
+
+    size = _ocf_read_entry(pf->ocf, pf->arch, index, &data);
+
+    pthread_mutex_lock(&pf->lock);
+    if (slot->state == PREFETCH_BUSY && slot->index == index) {
+      slot->blob = _ocf_blob_new(index, data, size);
+      slot->state = PREFETCH_READY;
+    } else {
+      // the reader moved on while we were busy
+      free(data);
+    }
+    pthread_cond_broadcast(&pf->cond);
+  }
+  pthread_mutex_unlock(&pf->lock);
+
+  return NULL;
+}
+
+// Starts prefetching depth items ahead of the iterator. Returns NULL if 
+// prefetching is not possible, the iterator then reads synchronously.
+struct eprefetch *_epub_prefetch_start(struct eiterator *it, int depth) {
+  struct eprefetch *pf;
+
+  pf = malloc(sizeof(struct eprefetch));
+  if (! pf) {
+    _epub_err_set_oom(&it->epub->error);
+    return NULL;
+  }
+  memset(pf, 0, sizeof(struct eprefetch));
+
+  pf->count = depth;
+  pf->slots = malloc(pf->count * sizeof(struct eprefetch_slot));
+  if (! pf->slots) {
+    _epub_err_set_oom(&it->epub->error);
+    free(pf);
+    return NULL;
+  }
+  memset(pf->slots, 0, pf->count * sizeof(struct eprefetch_slot));
+
+  // the worker may read the directory of the mapping but not build it
+  _ocf_map_directory(it->epub->ocf);
+  pf->ocf = it->epub->ocf;
+
+  if (! (pf->arch = _ocf_open_clone(it->epub->ocf))) {
+    _epub_print_debug(it->epub, DEBUG_WARNING, 
+                      "can't open archive for prefetching");
+    free(pf->slots);
+    free(pf);
+    return NULL;
+  }
+
+  pthread_mutex_init(&pf->lock, NULL);
+  pthread_cond_init(&pf->cond, NULL);
+
+  if (pthread_create(&pf->thread, NULL, _epub_prefetch_worker, pf) != 0) {
+    _epub_print_debug(it->epub, DEBUG_WARNING, "can't start prefetch thread");
+    pthread_mutex_destroy(&pf->lock);
+    pthread_cond_destroy(&pf->cond);
+    zip_discard(pf->arch);
+    free(pf->slots);
+    free(pf);
+    return NULL;
+  }
+
+  return pf;
+}
+
+void _epub_prefetch_stop(struct eprefetch *pf) {
+  int i;
+
+  if (! pf)
+    return;
+
+  pthread_mutex_lock(&pf->lock);
+  pf->stop = 1;
+  pthread_cond_broadcast(&pf->cond);
+  pthread_mutex_unlock(&pf->lock);
+  pthread_join(pf->thread, NULL);
+
+  for (i = 0; i < pf->count; i++)
+    _ocf_blob_release(pf->slots[i].blob);
+
+  pthread_mutex_destroy(&pf->lock);
+  pthread_cond_destroy(&pf->cond);
+  zip_discard(pf->arch);
+  free(pf->slots);
+  free(pf);
+}
+
+// Queues the given entries (in reading order) dropping everything else
+void _epub_prefetch_schedule(struct eprefetch *pf, zip_int64_t *indexes, 
+                             int count) {
+  struct eprefetch_slot *slot;
+  int i, j;
+
+  pthread_mutex_lock(&pf->lock);
+
+  for (i = 0; i < pf->count; i++) {
+    slot = &pf->slots[i];
+    if (slot->state == PREFETCH_EMPTY)
+      continue;
+
+    for (j = 0; j < count; j++) {
+      if (indexes[j] == slot->index)
+        break;
+    }
+
+    if (j < count) {
+      slot->order = j;
+      indexes[j] = -1;
+    } else {
+      _ocf_blob_release(slot->blob);
+      slot->blob = NULL;
+      slot->state = PREFETCH_EMPTY;
+    }
+  }
+
+  for (i = 0, j = 0; i < count; i++) {
+    if (indexes[i] < 0)
+      continue;
+
+    while (j < pf->count && pf->slots[j].state != PREFETCH_EMPTY)
+      j++;
+    if (j == pf->count)
+      break;
+
+    pf->slots[j].index = indexes[i];
+    pf->slots[j].order = i;
+    pf->slots[j].state = PREFETCH_QUEUED;
+  }
+
+  pthread_cond_broadcast(&pf->cond);
+  pthread_mutex_unlock(&pf->lock);
+}
+
+// Returns the prefetched blob of the entry at index or NULL if it wasn't 
+// scheduled. Waits for the worker if it is still inflating the entry.
+struct ocf_blob *_epub_prefetch_take(struct eprefetch *pf, zip_int64_t index) {
+  struct ocf_blob *blob = NULL;
+  struct eprefetch_slot *slot = NULL;
+  int i, waited = 0;
+
+  pthread_mutex_lock(&pf->lock);
+
+  for (i = 0; i < pf->count; i++) {
+    if (pf->slots[i].state != PREFETCH_EMPTY && pf->slots[i].index == index) {
+      slot = &pf->slots[i];
+      break;
+    }
+  }
+
+  if (slot && slot->state == PREFETCH_QUEUED) {
+    // not started yet, reading it here is faster than waiting
+    slot->state = PREFETCH_EMPTY;
+    slot = NULL;
+  } else if (slot && slot->state == PREFETCH_BUSY) {
+    waited = 1;
+    while (slot->state == PREFETCH_BUSY)
+      pthread_cond_wait(&pf->cond, &pf->lock);
+  }
+
+  if (slot) {
+    blob = slot->blob;
+    slot->blob = NULL;
+    slot->state = PREFETCH_EMPTY;
+  }
+
+  // a read the worker failed is done again by the reader
+  if (! blob)
+    pf->stats.missed++;
+  else if (waited)
+    pf->stats.waited++;
+  else
+    pf->stats.ready++;
+
+  pthread_mutex_unlock(&pf->lock);
+
+  return blob;
+}
+
+#else
+
+struct eprefetch *_epub_prefetch_start(struct eiterator *it, int depth) {
+  (void)depth;
+  _epub_print_debug(it->epub, DEBUG_INFO, 
+                    "prefetching is not supported on this platform");
+  return NULL;
+}
+
+void _epub_prefetch_stop(struct eprefetch *pf) {
+  (void)pf;
+}
+
+void _epub_prefetch_schedule(struct eprefetch *pf, zip_int64_t *indexes, 
+                             int count) {
+  (void)pf;
+  (void)indexes;
+  (void)count;
+}
+
+struct ocf_blob *_epub_prefetch_take(struct eprefetch *pf, zip_int64_t index) {
+  (void)pf;
+  (void)index;
+  return NULL;
+}
+
+#endif
@@ -0,0 +1,349 @@
+#include "epublib.h"
+
+#include <stdio.h>
+#include <limits.h>
+
+// Byte range reads of archive entries. Stored entries are read at the
+// offset. Deflated entries remember the inflater state every RANGE_SPAN
+// bytes of output (like zlib's examples/zran.c), so a read only inflates
+// from the closest checkpoint before the offset. Checkpoints are added
+// as reads go further into an entry.
+
+#define RANGE_SPAN 1048576 // output bytes between checkpoints
+#define RANGE_WINDOW 32768 // deflate window
+#define RANGE_CHUNK 16384 // raw bytes read at once through libzip
+
+// Reader of the raw (compressed) data of an entry
+struct ocf_rawreader {
+  const char *data; // the raw data in memory, or NULL
+  struct zip_file *file; // the raw data through libzip
+  zip_uint64_t size; // compressed size
+  zip_uint64_t pos; // next raw byte
+  unsigned char chunk[RANGE_CHUNK];
+};
+
+// Moves the reader to pos. Returns -1 on failure
+int _ocf_rawreader_seek(struct ocf_rawreader *rd, zip_uint64_t pos) {
+  zip_int64_t len;
+
+  if (pos > rd->size)
+    return -1;
+
+  if (rd->data || pos == rd->pos) {
+    rd->pos = pos;
+    return 0;
+  }
+
+  if (zip_fseek(rd->file, pos, SEEK_SET) == 0) {
+    rd->pos = pos;
+    return 0;
+  }
+
+  // not seekable, skip forward
+  if (pos < rd->pos)
+    return -1;
+
+  while (rd->pos < pos) {
+    len = pos - rd->pos < RANGE_CHUNK ? pos - rd->pos : RANGE_CHUNK;
+    if ((len = zip_fread(rd->file, rd->chunk, len)) <= 0)
+      return -1;
+    rd->pos += len;
+  }
+
+  return 0;
+}
+
+// Feeds strm the raw data following the reader position. Returns the
+// number of bytes fed (0 at the end of the data) or -1 on failure
+int _ocf_rawreader_fill(struct ocf_rawreader *rd, z_stream *strm) {
+  zip_uint64_t left = rd->size - rd->pos;
+  zip_int64_t len;
+
+  if (rd->data) {
+    len = left < UINT_MAX ? left : UINT_MAX;
+    strm->next_in = (Bytef *)rd->data + rd->pos;
+  } else {
+    len = left < RANGE_CHUNK ? left : RANGE_CHUNK;
+    if (len && (len = zip_fread(rd->file, rd->chunk, len)) == -1)
+      return -1;
+    strm->next_in = rd->chunk;
+  }
+
+  strm->avail_in = (uInt)len;
+  rd->pos += len;
+
+  return (int)len;
+}
+
+// Returns the checkpoints of the entry at index, creating them as needed
+struct ocf_range_index *_ocf_range_index(struct ocf *ocf, zip_int64_t index) {
+  struct ocf_range_index *ri;
+
+  for (ri = ocf->ranges; ri; ri = ri->next) {
+    if (ri->index == index)
+      return ri;
+  }
+
+  ri = malloc(sizeof(struct ocf_range_index));
+  if (! ri) {
+    _epub_err_set_oom(&ocf->epub->error);
+    return NULL;
+  }
+  memset(ri, 0, sizeof(struct ocf_range_index));
+
+  // the start of the stream needs no state
+  ri->points = malloc(sizeof(struct ocf_checkpoint));
+  if (! ri->points) {
+    _epub_err_set_oom(&ocf->epub->error);
+    free(ri);
+    return NULL;
+  }
+  memset(ri->points, 0, sizeof(struct ocf_checkpoint));
+  ri->count = ri->alloc = 1;
+  ri->index = index;
+
+  ri->next = ocf->ranges;
+  ocf->ranges = ri;
+
+  return ri;
+}
+
+// Remembers the inflater state after out bytes of output and in bytes of
+// input. window is the output ring and left its free space.
+void _ocf_range_add_point(struct ocf_range_index *ri, z_stream *strm,
+                          zip_uint64_t in, zip_uint64_t out,
+                          unsigned char *window) {
+  struct ocf_checkpoint *point;
+  unsigned int left = strm->avail_out;
+
+  if (ri->count == ri->alloc) {
+    point = realloc(ri->points,
+                    ri->alloc * 2 * sizeof(struct ocf_checkpoint));
+    // not fatal, reads just start further back
+    if (! point)
+      return;
+    ri->points = point;
+    ri->alloc *= 2;
+  }
+
+  point = &ri->points[ri->count];
+  if (! (point->window = malloc(RANGE_WINDOW)))
+    return;
+
+  point->in = in;
+  point->out = out;
+  point->bits = strm->data_type & 7;
+
+  // the ring from its oldest byte on
+  if (left)
+    memcpy(point->window, window + RANGE_WINDOW - left, left);
+  if (left < RANGE_WINDOW)
+    memcpy(point->window + left, window, RANGE_WINDOW - left);
+
+  ri->count++;
+}
+
+// Inflates len bytes from offset into buf starting from the closest
+// checkpoint. Returns the number of bytes read or -1 on failure.
+int _ocf_range_inflate(struct ocf_range_index *ri, struct ocf_rawreader *rd,
+                       zip_uint64_t offset, char *buf, int len) {
+  struct ocf_checkpoint *point = &ri->points[0];
+  unsigned char *window;
+  z_stream strm;
+  zip_uint64_t in, out, produced, skip;
+  uInt availIn;
+  unsigned int from;
+  int i, ret = Z_OK, copied = 0, n;
+
+  for (i = 1; i < ri->count && ri->points[i].out <= offset; i++)
+    point = &ri->points[i];
+
+  if (! (window = malloc(RANGE_WINDOW)))
+    return -1;
+
+  memset(&strm, 0, sizeof(z_stream));
+  if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+    free(window);
+    return -1;
+  }
+
+  in = point->in;
+  out = point->out;
+
+  // a checkpoint in the middle of a byte starts with its remaining bits
+  if (_ocf_rawreader_seek(rd, point->bits ? in - 1 : in) == -1)
+    ret = Z_DATA_ERROR;
+  else if (point->bits) {
+    if (_ocf_rawreader_fill(rd, &strm) < 1)
+      ret = Z_DATA_ERROR;
+    else {
+      inflatePrime(&strm, point->bits,
+                   strm.next_in[0] >> (8 - point->bits));
+      strm.next_in++;
+      strm.avail_in--;
+    }
+  }
+
+  if (point->window) {
+    inflateSetDictionary(&strm, point->window, RANGE_WINDOW);
+    memcpy(window, point->window, RANGE_WINDOW);
+  }
+  strm.next_out = window;
+  strm.avail_out = RANGE_WINDOW;
+
+  while (ret == Z_OK && copied < len) {
+    if (! strm.avail_in && _ocf_rawreader_fill(rd, &strm) == -1) {
+      ret = Z_DATA_ERROR;
+      break;
+    }
+
+    // the output ring is full, start over
+    if (! strm.avail_out) {
+      strm.next_out = window;
+      strm.avail_out = RANGE_WINDOW;
+    }
+
+    from = RANGE_WINDOW - strm.avail_out;
+    availIn = strm.avail_in;
+    ret = inflate(&strm, Z_BLOCK);
+    in += availIn - strm.avail_in;
+    produced = RANGE_WINDOW - strm.avail_out - from;
+
+    // out never goes past offset + copied
+    if (out + produced > offset + copied) {
+      skip = offset + copied - out;
+      n = produced - skip < (zip_uint64_t)(len - copied) ?
+        (int)(produced - skip) : len - copied;
+      memcpy(buf + copied, window + from + skip, n);
+      copied += n;
+    }
+    out += produced;
+
+    // block boundary (but not the last block), the state can be saved
+    if (ret == Z_OK && (strm.data_type & 128) && ! (strm.data_type & 64) &&
+        out >= ri->points[ri->count - 1].out + RANGE_SPAN)
+      _ocf_range_add_point(ri, &strm, in, out, window);
+  }
+
+  inflateEnd(&strm);
+  free(window);
+
+  if (ret != Z_OK && ret != Z_STREAM_END)
+    return -1;
+
+  return copied;
+}
+
+// Reads through the plain libzip reader, seeking if the entry allows it
+int _ocf_range_stream(struct ocf *ocf, zip_int64_t index,
+                      zip_uint64_t offset, char *buf, int len) {
+  struct zip_file *file;
+  zip_uint64_t pos = 0;
+  zip_int64_t n = 0;
+
+  if (! (file = zip_fopen_index(ocf->arch, index, 0)))
+    return -1;
+
+  if (zip_fseek(file, offset, SEEK_SET) == 0)
+    pos = offset;
+
+  // skip forward using buf as scratch space
+  while (pos < offset && n != -1) {
+    n = offset - pos < (zip_uint64_t)len ? (zip_int64_t)(offset - pos) : len;
+    if ((n = zip_fread(file, buf, n)) <= 0)
+      n = -1;
+    else
+      pos += n;
+  }
+
+  if (n != -1)
+    n = zip_fread(file, buf, len);
+
+  zip_fclose(file);
+
+  return (int)n;
+}
+
+// Reads up to len bytes of the entry at index from offset into buf.
+// Returns the number of bytes read, 0 past the end of the entry or -1
+// on failure.
+int _ocf_get_range(struct ocf *ocf, zip_int64_t index, zip_uint64_t offset,
+                   char *buf, int len) {
+  struct zip *arch = ocf->arch;
+  struct zip_stat fileStat;
+  struct ocf_rawreader *rd;
+  struct ocf_range_index *ri;
+  const char *raw;
+  int ret;
+
+  zip_stat_init(&fileStat);
+  if (zip_stat_index(arch, index, ZIP_FL_UNCHANGED, &fileStat) == -1) {
+    _epub_print_debug(ocf->epub, DEBUG_INFO, "entry %ld - %s",
+                      (long)index, zip_strerror(arch));
+    return -1;
+  }
+
+  if (offset >= fileStat.size || len <= 0)
+    return 0;
+  if (fileStat.size - offset < (zip_uint64_t)len)
+    len = (int)(fileStat.size - offset);
+
+  _ocf_map_directory(ocf);
+  raw = _ocf_raw_data(ocf, index);
+
+  if (fileStat.encryption_method != ZIP_EM_NONE ||
+      (fileStat.comp_method != ZIP_CM_STORE &&
+       fileStat.comp_method != ZIP_CM_DEFLATE))
+    return _ocf_range_stream(ocf, index, offset, buf, len);
+
+  // only comp_size bytes of a stored entry are known to be there, so one
+  // claiming another size is left to libzip
+  if (fileStat.comp_method == ZIP_CM_STORE) {
+    if (! raw || fileStat.comp_size != fileStat.size)
+      return _ocf_range_stream(ocf, index, offset, buf, len);
+    memcpy(buf, raw + offset, len);
+    return len;
+  }
+
+  if (! (ri = _ocf_range_index(ocf, index)))
+    return -1;
+
+  if (! (rd = malloc(sizeof(struct ocf_rawreader)))) {
+    _epub_err_set_oom(&ocf->epub->error);
+    return -1;
+  }
+  memset(rd, 0, sizeof(struct ocf_rawreader));
+  rd->data = raw;
+  rd->size = fileStat.comp_size;
+
+  if (! raw &&
+      ! (rd->file = zip_fopen_index(arch, index, ZIP_FL_COMPRESSED))) {
+    _epub_print_debug(ocf->epub, DEBUG_INFO, "%s - %s",
+                      fileStat.name, zip_strerror(arch));
+    free(rd);
+    return -1;
+  }
+
+  if ((ret = _ocf_range_inflate(ri, rd, offset, buf, len)) == -1)
+    _epub_print_debug(ocf->epub, DEBUG_INFO, "%s - corrupt data",
+                      fileStat.name);
+
+  if (rd->file)
+    zip_fclose(rd->file);
+  free(rd);
+
+  return ret;
+}
+
+void _ocf_range_close(struct ocf *ocf) {
+  struct ocf_range_index *ri;
+  int i;
+
+  while ((ri = ocf->ranges)) {
+    ocf->ranges = ri->next;
+    for (i = 0; i < ri->count; i++)
+      free(ri->points[i].window);
+    free(ri->points);
+    free(ri);
+  }
+}
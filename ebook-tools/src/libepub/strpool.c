@@ -0,0 +1,108 @@
+#include "strpool.h"
+#include <stdlib.h>
+
+#define STRPOOL_START(k) ((size_t)STRPOOL_BASE * ((1u << (k)) - 1))
+#define STRPOOL_SIZE(k) ((size_t)STRPOOL_BASE << (k))
+
+struct strpool *strpool_new(void)
+{
+  struct strpool *pool = calloc(1, sizeof(struct strpool));
+
+  if (!pool)
+    return NULL;
+
+  pool->chunks[0] = malloc(STRPOOL_SIZE(0));
+  if (!pool->chunks[0]) {
+    free(pool);
+    return NULL;
+  }
+
+  // offset 0 is NULL
+  pool->used = 1;
+
+  return pool;
+}
+
+void strpool_free(struct strpool *pool)
+{
+  int k;
+
+  if (!pool)
+    return;
+
+  for (k = 0; k < STRPOOL_CHUNKS; k++)
+    free(pool->chunks[k]);
+  free(pool);
+}
+
+char *strpool_alloc(struct strpool *pool, size_t size)
+{
+  int k = pool->current;
+  char *data;
+
+  if (size > STRPOOL_SIZE(k) - pool->used) {
+    // the next chunk big enough, the rest of this one is left unused
+    for (k++; k < STRPOOL_CHUNKS && size > STRPOOL_SIZE(k); k++)
+      ;
+    if (k == STRPOOL_CHUNKS)
+      return NULL;
+
+    pool->chunks[k] = malloc(STRPOOL_SIZE(k));
+    if (!pool->chunks[k])
+      return NULL;
+    pool->current = k;
+    pool->used = 0;
+  }
+
+  data = pool->chunks[k] + pool->used;
+  pool->used += size;
+
+  return data;
+}
+
+char *strpool_strdup(struct strpool *pool, const char *str)
+{
+  size_t len;
+  char *copy;
+
+  if (!str)
+    return NULL;
+
+  len = strlen(str) + 1;
+  if ((copy = strpool_alloc(pool, len)))
+    memcpy(copy, str, len);
+
+  return copy;
+}
+
+char *strpool_get(const struct strpool *pool, uint32_t offset)
+{
+  size_t x = offset / STRPOOL_BASE + 1;
+  int k = 0;
+
+  if (!offset)
+    return NULL;
+
+  // chunk k starts at STRPOOL_BASE * (2^k - 1)
+  while (x >>= 1)
+    k++;
+
+  return pool->chunks[k] + (offset - STRPOOL_START(k));
+}
+
+uint32_t strpool_offset(const struct strpool *pool, const char *str)
+{
+  int k;
+
+  if (!str)
+    return 0;
+
+  // most strings are in the latest chunks
+  for (k = pool->current; k >= 0; k--) {
+    if (pool->chunks[k] && str >= pool->chunks[k] &&
+        str < pool->chunks[k] + STRPOOL_SIZE(k))
+      return (uint32_t)(STRPOOL_START(k) + (str - pool->chunks[k]));
+  }
+
+  return 0;
+}
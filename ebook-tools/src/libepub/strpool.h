@@ -0,0 +1,47 @@
+#ifndef STRPOOL_H
+#define STRPOOL_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#define STRPOOL_BASE 4096 // size of the first chunk
+#define STRPOOL_CHUNKS 20 // chunks needed to address 4G
+
+// Strings addressed by 32 bit offsets. Chunk k holds STRPOOL_BASE << k
+// bytes from offset STRPOOL_BASE * (2^k - 1) on and is allocated when
+// first needed. Chunks never move, so pointers to the strings stay valid
+// as well. Offset 0 stands for NULL.
+struct strpool {
+  char *chunks[STRPOOL_CHUNKS];
+  int current; // chunk strings are added to
+  size_t used; // bytes used in the current chunk
+};
+
+// Allocates an empty pool, returns NULL on failure
+struct strpool *strpool_new(void);
+
+// Frees the pool and all its strings
+void strpool_free(struct strpool *pool);
+
+// Returns size contiguous bytes or NULL on failure
+char *strpool_alloc(struct strpool *pool, size_t size);
+
+// Copies a string (NULL gives NULL), returns NULL on failure
+char *strpool_strdup(struct strpool *pool, const char *str);
+
+// Returns the string at offset (NULL for 0)
+char *strpool_get(const struct strpool *pool, uint32_t offset);
+
+// Returns the offset of a pointer into the pool, 0 for NULL or a pointer
+// the pool doesn't hold
+uint32_t strpool_offset(const struct strpool *pool, const char *str);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STRPOOL_H
@@ -0,0 +1,240 @@
+#include "epublib.h"
+
+#include <stdio.h>
+#ifndef _WIN32
+# include <unistd.h>
+#endif
+
+// Parsing of the toc on a worker thread (EPUB_OPEN_TOC). The worker
+// starts as soon as the spine names the toc, while the calling thread
+// goes on with the rest of the package, and is joined before the book
+// is returned. It reads through its own archive handle and builds the
+// toc in a book of its own, since the arena, strings and interned table
+// of a book aren't thread safe. Once joined, the strings the book looks
+// up by offset or compares by address are moved over to it; everything
+// else stays in the worker's arena and strings until the book is closed.
+
+// Returns the string at offset of the worker's strings as an offset in
+// the book's strings, interned or copied
+uint32_t _opf_toc_offset(struct epub *epub, struct etocload *tl,
+                         uint32_t offset, int interned) {
+  xmlChar *str = _epub_str(&tl->epub, offset);
+
+  if (! str)
+    return 0;
+
+  if (interned)
+    str = _epub_intern(epub, str);
+  else if (! (str = (xmlChar *)strpool_strdup(epub->strings, (char *)str)))
+    _epub_err_set_oom(&epub->error);
+
+  return strpool_offset(epub->strings, (char *)str);
+}
+
+void _opf_toc_adopt_labels(struct epub *epub, struct tocLabel *labels,
+                           int count) {
+  int i;
+
+  // compared with the book's languages by address
+  for (i = 0; i < count; i++) {
+    labels[i].lang = _epub_intern(epub, labels[i].lang);
+    labels[i].dir = _epub_intern(epub, labels[i].dir);
+  }
+}
+
+void _opf_toc_adopt_category(struct epub *epub, struct etocload *tl,
+                             struct tocCategory *tc) {
+  struct tocItem *item;
+  int i;
+
+  tc->class = _epub_intern(epub, tc->class);
+  _opf_toc_adopt_labels(epub, tc->info.items, tc->info.count);
+  _opf_toc_adopt_labels(epub, tc->label.items, tc->label.count);
+
+  for (i = 0; i < tc->items.count; i++) {
+    item = &tc->items.items[i];
+    item->id = _opf_toc_offset(epub, tl, item->id, 0);
+    item->src = _opf_toc_offset(epub, tl, item->src, 0);
+    item->class = _opf_toc_offset(epub, tl, item->class, 1);
+    item->type = _opf_toc_offset(epub, tl, item->type, 1);
+  }
+}
+
+// Hands the toc of a finished worker over to the book
+void _opf_toc_adopt(struct opf *opf, struct etocload *tl) {
+  struct epub *epub = opf->epub;
+  struct toc *toc = tl->opf.toc;
+
+  opf->tocLoaded = 1;
+
+  // the errors of the worker are the book's, unless the book has one of
+  // its own; the worker has printed its own already
+  if ((tl->epub.error.type || tl->epub.error.len) &&
+      ! epub->error.type && ! epub->error.len) {
+    epub->error = tl->epub.error;
+    if (! epub->error.type)
+      epub->error.str = epub->error.lastStr;
+  }
+
+  if (! toc)
+    return;
+
+  if (toc->navMap)
+    _opf_toc_adopt_category(epub, tl, toc->navMap);
+  if (toc->pageList)
+    _opf_toc_adopt_category(epub, tl, toc->pageList);
+  if (toc->navList)
+    _opf_toc_adopt_category(epub, tl, toc->navList);
+  _opf_toc_adopt_labels(epub, toc->labels.items, toc->labels.count);
+
+  opf->toc = toc;
+  _opf_resolve_toc_labels(opf);
+
+  // nothing is interned in the worker's book anymore
+  hash_free(tl->epub.interned);
+  tl->epub.interned = NULL;
+}
+
+#ifndef _WIN32
+
+void *_opf_toc_worker(void *arg) {
+  struct etocload *tl = arg;
+  char *tocStr = NULL;
+  int size;
+
+  size = _ocf_read_entry(tl->ocf, tl->arch, tl->index, &tocStr);
+  if (size <= 0) {
+    _epub_print_debug(&tl->epub, DEBUG_ERROR, "Faulty toc file %s", tl->name);
+  } else {
+    // like _ocf_get_file_index
+    if (tl->epub.debug >= DEBUG_VERBOSE) {
+      _epub_print_debug(&tl->epub, DEBUG_VERBOSE, "--------- Begin %s",
+                        zip_get_name(tl->arch, tl->index, 0));
+      fprintf(stderr, "%s\n", tocStr);
+      _epub_print_debug(&tl->epub, DEBUG_VERBOSE, "--------- End %s",
+                        zip_get_name(tl->arch, tl->index, 0));
+    }
+    _opf_parse_toc(&tl->opf, tocStr, size);
+  }
+
+  free(tocStr);
+
+  return NULL;
+}
+
+// Starts parsing the toc named by the spine if the book was opened with
+// EPUB_OPEN_TOC. Without a worker the toc is parsed by _opf_toc_join.
+void _opf_toc_start(struct opf *opf) {
+  struct epub *epub = opf->epub;
+  struct manifest *item;
+  struct etocload *tl;
+
+  if (! (epub->flags & EPUB_OPEN_TOC) || ! opf->tocName || opf->tocLoad)
+    return;
+
+  // a toc that can't be read is reported by _opf_load_toc
+  item = _opf_manifest_get_by_id(opf, opf->tocName);
+  if (! item || item->index == -1)
+    return;
+
+  // with a single processor the worker would only take turns with us
+  if (sysconf(_SC_NPROCESSORS_ONLN) < 2)
+    return;
+
+  tl = malloc(sizeof(struct etocload));
+  if (! tl) {
+    _epub_err_set_oom(&epub->error);
+    return;
+  }
+  memset(tl, 0, sizeof(struct etocload));
+
+  if (_epub_new_pools(&tl->epub) == -1) {
+    _epub_err_set_oom(&epub->error);
+    free(tl);
+    return;
+  }
+  tl->epub.debug = epub->debug;
+  tl->epub.flags = epub->flags;
+  tl->epub.opf = &tl->opf;
+  tl->opf.epub = &tl->epub;
+  tl->name = opf->tocName;
+  tl->index = item->index;
+
+  // the worker may read the directory of the mapping but not build it
+  _ocf_map_directory(epub->ocf);
+  tl->ocf = epub->ocf;
+
+  if (! (tl->arch = _ocf_open_clone(epub->ocf))) {
+    _epub_print_debug(epub, DEBUG_WARNING,
+                      "can't open archive for parsing the toc");
+    _epub_free_pools(&tl->epub);
+    free(tl);
+    return;
+  }
+
+  // libxml sets its globals up once, before threads use it
+  xmlInitParser();
+
+  if (pthread_create(&tl->thread, NULL, _opf_toc_worker, tl) != 0) {
+    _epub_print_debug(epub, DEBUG_WARNING, "can't start toc thread");
+    zip_discard(tl->arch);
+    _epub_free_pools(&tl->epub);
+    free(tl);
+    return;
+  }
+
+  tl->running = 1;
+  opf->tocLoad = tl;
+}
+
+// Waits for the worker to finish
+void _opf_toc_wait(struct etocload *tl) {
+  if (! tl->running)
+    return;
+
+  pthread_join(tl->thread, NULL);
+  zip_discard(tl->arch);
+  tl->arch = NULL;
+  tl->running = 0;
+}
+
+// Waits for the toc worker and hands its toc over to the book, or parses
+// the toc here if no worker was started
+void _opf_toc_join(struct opf *opf) {
+  struct etocload *tl = opf->tocLoad;
+
+  if (! tl) {
+    _opf_load_toc(opf);
+    return;
+  }
+
+  if (tl->running) {
+    _opf_toc_wait(tl);
+    _opf_toc_adopt(opf, tl);
+  }
+}
+
+void _opf_toc_free(struct etocload *tl) {
+  if (! tl)
+    return;
+
+  _opf_toc_wait(tl);
+  _epub_free_pools(&tl->epub);
+  free(tl);
+}
+
+#else
+
+void _opf_toc_start(struct opf *opf) {
+  (void)opf;
+}
+
+void _opf_toc_join(struct opf *opf) {
+  _opf_load_toc(opf);
+}
+
+void _opf_toc_free(struct etocload *tl) {
+  (void)tl;
+}
+
+#endif
@@ -1,27 +1,45 @@
 #include "url.h"
 #include <stdio.h>
 
-// simplified version of base64. Modifies @str in-place.
-// For now just replaces "%20" with " ".
-// TODO: extend it or use some library
+// returns the value of hex digit @c or -1
+int url_hex_value(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Decodes %XX escapes of URL @str in-place. A '%' not followed by two
+// hex digits is kept as is.
 void url_decode(char *str, size_t len)
 {
   size_t code_length = 3;
   size_t i;
   size_t current_offset = 0;
+  int high, low;
 
   if (str == NULL)
-    return NULL;
+    return;
 
-  for (i = 0; i + current_offset < len && str[i]; ++i) {
+  for (i = 0; i + current_offset < len && str[i + current_offset]; ++i) {
     char c = str[i + current_offset];
     str[i] = c;
 
-    if (c == '%') {
-      if (!strncmp(&str[i + current_offset], "%20", code_length)) {
-       str[i] = ' ';
-       current_offset += code_length - 1;
+    if (c == '%' && i + current_offset + code_length <= len) {
+      high = url_hex_value(str[i + current_offset + 1]);
+      low = high == -1 ? -1 : url_hex_value(str[i + current_offset + 2]);
+      if (low != -1) {
+        str[i] = (char)(high * 16 + low);
+        current_offset += code_length - 1;
       }
     }
   }
-}
\ No newline at end of file
+
+  // the decoded string is shorter, terminate it
+  if (current_offset)
+    str[i] = '\0';
+}
@@ -7,8 +7,8 @@ extern "C" {
 
 #include <string.h>
 
-// simplified version of base64. Modifies @str in-place.
-// For now just replaces "%20" with " ".
+// Decodes %XX escapes of URL @str in-place. A '%' not followed by two
+// hex digits is kept as is.
 void url_decode(char *str, size_t len);
 
 #ifdef __cplusplus
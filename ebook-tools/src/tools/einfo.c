@@ -16,9 +16,13 @@ void usage(int code) {
   fprintf(stderr, "   -vv\t Verbose (warnings)\n");
   fprintf(stderr, "   -vvv\t Verbose (info)\n");
   fprintf(stderr, "   -d\t Debug mode (implies -vvv)\n");
+  fprintf(stderr, "   -m\t Map the file into memory\n");
+  fprintf(stderr, "   -s\t Parse the package and toc with SAX2 callbacks\n");
+  fprintf(stderr, "   -c\t Parse the toc on a thread of its own while opening\n");
   fprintf(stderr, "   -p\t Linear print book (normal reading)\n");
   fprintf(stderr, "   -pp\t Print the whole book\n");
   fprintf(stderr, "   -t <tour id>\t prints the tour <tour id>\n");
+  fprintf(stderr, "   -x <dir>\t extracts the book into <dir>\n");
 
   exit(code);
 }
@@ -27,7 +31,8 @@ int main(int argc , char **argv) {
   struct epub *epub;
   char *filename = NULL;
   char *tourId = NULL;
-  int verbose = 0, print = 0, debug = 0, quiet = 0, tour = 0;
+  char *extractDir = NULL;
+  int verbose = 0, print = 0, debug = 0, quiet = 0, tour = 0, flags = 0;
   
   int i, j, len;
   
@@ -48,6 +53,15 @@ int main(int argc , char **argv) {
         case 'q':
           quiet++;
           break;
+        case 'm':
+          flags |= EPUB_OPEN_MMAP;
+          break;
+        case 's':
+          flags |= EPUB_OPEN_SAX;
+          break;
+        case 'c':
+          flags |= EPUB_OPEN_TOC;
+          break;
         case 'p':
           print++;
           break;
@@ -72,6 +86,18 @@ int main(int argc , char **argv) {
           i++;
           goto loop;
           break;
+        case 'x':
+          i++;
+          if (i<argc) {
+            extractDir = argv[i];
+          } else {  
+            fprintf(stderr, "Missing directory\n");
+            usage(2);
+          }
+
+          // the directory may be the last argument
+          j = len;
+          break;
         default:
           fprintf(stderr, "Unknown flag %s\n", argv[i]);
           usage(2);
@@ -97,7 +123,7 @@ int main(int argc , char **argv) {
   if (debug)
     verbose = 4;
   
-  if (! (epub = epub_open(filename, verbose)))
+  if (! (epub = epub_open_ex(filename, flags, verbose)))
     quit(1);
   
   if (! quiet)
@@ -125,6 +151,10 @@ int main(int argc , char **argv) {
 
   }
   
+  if (extractDir && epub_extract_all(epub, extractDir, 4) != 0) {
+    fprintf(stderr, "Failed to extract the book into %s\n", extractDir);
+  }
+
   if (tour) {
     printf("Tours are still not supported\n");
   }
@@ -0,0 +1,109 @@
+#include <CppUTest/TestHarness.h>
+
+#include <cstdint>
+#include <arena.h>
+
+TEST_GROUP(Arena)
+{};
+
+TEST(Arena, AlignsAllocations)
+{
+    struct arena *arena = arena_new(0);
+
+    CHECK(arena_strdup(arena, "x") != NULL);
+    for (int i = 1; i < 100; i++) {
+        void *data = arena_alloc(arena, i);
+        uintptr_t misalignment = reinterpret_cast<uintptr_t>(data) % sizeof(void *);
+        CHECK(data != NULL);
+        LONGS_EQUAL(0, misalignment);
+    }
+    arena_free(arena);
+}
+
+TEST(Arena, CopiesStrings)
+{
+    struct arena *arena = arena_new(16);
+    const char *text = "some text";
+
+    char *copy = arena_strdup(arena, text);
+    STRCMP_EQUAL(text, copy);
+    CHECK(copy != text);
+    STRCMP_EQUAL("some", arena_strndup(arena, text, 4));
+    STRCMP_EQUAL("", arena_strdup(arena, ""));
+    POINTERS_EQUAL(NULL, arena_strdup(arena, NULL));
+    arena_free(arena);
+}
+
+TEST(Arena, ZeroesMemory)
+{
+    struct arena *arena = arena_new(0);
+    unsigned char *data = static_cast<unsigned char *>(arena_zalloc(arena, 64));
+
+    for (int i = 0; i < 64; i++)
+        LONGS_EQUAL(0, data[i]);
+    arena_free(arena);
+}
+
+TEST(Arena, KeepsEarlierAllocationsWhileGrowing)
+{
+    struct arena *arena = arena_new(0);
+    int *small[1000];
+
+    // many chunks worth of small allocations and some big ones in between
+    for (int i = 0; i < 1000; i++) {
+        small[i] = static_cast<int *>(arena_alloc(arena, 100 * sizeof(int)));
+        small[i][0] = small[i][99] = i;
+        if (i % 100 == 0)
+            CHECK(arena_alloc(arena, 1 << 20) != NULL);
+    }
+    for (int i = 0; i < 1000; i++) {
+        LONGS_EQUAL(i, small[i][0]);
+        LONGS_EQUAL(i, small[i][99]);
+    }
+    LONGS_EQUAL(1000 * 100 * sizeof(int) + 10 * (1 << 20), arena->used);
+    arena_free(arena);
+}
+
+TEST(Arena, GrowsAllocations)
+{
+    struct arena *arena = arena_new(0);
+    int *data = static_cast<int *>(arena_alloc(arena, 4 * sizeof(int)));
+    size_t alloc = 4;
+
+    // in place at first, in chunks of their own once they are big
+    for (int i = 0; i < 100000; i++) {
+        if (static_cast<size_t>(i) == alloc) {
+            void *grown = arena_realloc(arena, data, alloc * sizeof(int),
+                                        2 * alloc * sizeof(int));
+            CHECK(grown != NULL);
+            data = static_cast<int *>(grown);
+            alloc *= 2;
+        }
+        data[i] = i;
+        if (i % 1000 == 0)
+            CHECK(arena_alloc(arena, 100) != NULL);
+    }
+    for (int i = 0; i < 100000; i++)
+        LONGS_EQUAL(i, data[i]);
+    arena_free(arena);
+}
+
+TEST(Arena, CopiesAllocationsItCantGrow)
+{
+    struct arena *arena = arena_new(0);
+    char *first = arena_strdup(arena, "first");
+    char *second = arena_strdup(arena, "second");
+
+    char *grown = static_cast<char *>(arena_realloc(arena, first, 6, 64));
+    CHECK(grown != first);
+    STRCMP_EQUAL("first", grown);
+    STRCMP_EQUAL("second", second);
+    POINTERS_EQUAL(grown, arena_realloc(arena, grown, 64, 32));
+    CHECK(arena_realloc(arena, NULL, 0, 16) != NULL);
+    arena_free(arena);
+}
+
+TEST(Arena, FreesNull)
+{
+    arena_free(NULL);
+}
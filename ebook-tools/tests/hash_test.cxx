@@ -0,0 +1,122 @@
+#include <CppUTest/TestHarness.h>
+
+#include <cstdio>
+#include <hash.h>
+
+struct item {
+    const char *id;
+    int value;
+};
+
+static const char *item_key(void *data, void *)
+{
+    return static_cast<item *>(data)->id;
+}
+
+// keys are ids into a table passed as the hash data
+static const char *indexed_key(void *data, void *table)
+{
+    return static_cast<const char **>(table)[*static_cast<int *>(data)];
+}
+
+TEST_GROUP(Hash)
+{};
+
+TEST(Hash, EmptyHashFindsNothing)
+{
+    struct hash *hash = hash_new(item_key, NULL, 0);
+
+    POINTERS_EQUAL(NULL, hash_get(hash, "missing"));
+    POINTERS_EQUAL(NULL, hash_get(hash, ""));
+    LONGS_EQUAL(0, hash->count);
+    hash_free(hash);
+}
+
+TEST(Hash, FindsAddedItems)
+{
+    struct hash *hash = hash_new(item_key, NULL, 2);
+    item a = {"a", 1};
+    item b = {"b", 2};
+
+    LONGS_EQUAL(1, hash_add(hash, &a));
+    LONGS_EQUAL(1, hash_add(hash, &b));
+    POINTERS_EQUAL(&a, hash_get(hash, "a"));
+    POINTERS_EQUAL(&b, hash_get(hash, "b"));
+    POINTERS_EQUAL(NULL, hash_get(hash, "c"));
+    hash_free(hash);
+}
+
+TEST(Hash, FirstItemWinsOnDuplicateKeys)
+{
+    struct hash *hash = hash_new(item_key, NULL, 0);
+    item first = {"id", 1};
+    item second = {"id", 2};
+
+    LONGS_EQUAL(1, hash_add(hash, &first));
+    LONGS_EQUAL(0, hash_add(hash, &second));
+    POINTERS_EQUAL(&first, hash_get(hash, "id"));
+    LONGS_EQUAL(1, hash->count);
+    hash_free(hash);
+}
+
+TEST(Hash, ItemsWithoutKeyAreRefused)
+{
+    struct hash *hash = hash_new(item_key, NULL, 0);
+    item nokey = {NULL, 0};
+
+    LONGS_EQUAL(-1, hash_add(hash, &nokey));
+    LONGS_EQUAL(-1, hash_add(hash, NULL));
+    LONGS_EQUAL(0, hash->count);
+    hash_free(hash);
+}
+
+TEST(Hash, KeysAreCaseSensitive)
+{
+    struct hash *hash = hash_new(item_key, NULL, 0);
+    item lower = {"cover", 1};
+
+    hash_add(hash, &lower);
+    POINTERS_EQUAL(&lower, hash_get(hash, "cover"));
+    POINTERS_EQUAL(NULL, hash_get(hash, "Cover"));
+    hash_free(hash);
+}
+
+TEST(Hash, GrowsPastItsHint)
+{
+    const int count = 5000;
+    struct hash *hash = hash_new(item_key, NULL, 1);
+    item *items = new item[count];
+    char (*ids)[16] = new char[count][16];
+    int i;
+
+    for (i = 0; i < count; i++) {
+        snprintf(ids[i], sizeof(ids[i]), "page%d", i);
+        items[i].id = ids[i];
+        items[i].value = i;
+        LONGS_EQUAL(1, hash_add(hash, &items[i]));
+    }
+
+    LONGS_EQUAL(count, hash->count);
+    CHECK(hash->count < hash->size);
+    for (i = 0; i < count; i++)
+        POINTERS_EQUAL(&items[i], hash_get(hash, ids[i]));
+    POINTERS_EQUAL(NULL, hash_get(hash, "page5000"));
+
+    delete[] ids;
+    delete[] items;
+    hash_free(hash);
+}
+
+TEST(Hash, PassesItsDataToTheKeys)
+{
+    const char *names[] = {"zero", "one", "two"};
+    int indexes[] = {0, 1, 2};
+    struct hash *hash = hash_new(indexed_key, names, 0);
+
+    for (int i = 0; i < 3; i++)
+        LONGS_EQUAL(1, hash_add(hash, &indexes[i]));
+    POINTERS_EQUAL(&indexes[1], hash_get(hash, "one"));
+    POINTERS_EQUAL(&indexes[2], hash_get(hash, "two"));
+    POINTERS_EQUAL(NULL, hash_get(hash, "three"));
+    hash_free(hash);
+}
@@ -0,0 +1,116 @@
+#include <CppUTest/TestHarness.h>
+
+#include <ctime>
+
+extern "C" {
+#include <linklist.h>
+}
+
+struct toc_entry {
+    int play_order;
+    int position;
+};
+
+static int compare_entries(void *first, void *second)
+{
+    return static_cast<toc_entry *>(first)->play_order -
+        static_cast<toc_entry *>(second)->play_order;
+}
+
+static listPtr new_list(toc_entry *entries, int count)
+{
+    listPtr list = NewListAlloc(LIST, NULL, NULL, compare_entries);
+
+    for (int i = 0; i < count; i++) {
+        entries[i].position = i;
+        AddNode(list, NewListNode(list, &entries[i]));
+    }
+    return list;
+}
+
+static void check_sorted(listPtr list, int count)
+{
+    listnodePtr node = list->Head;
+    listnodePtr prev = NULL;
+    int seen = 0;
+
+    POINTERS_EQUAL(list->Head, list->Current);
+    for (; node; prev = node, node = node->Next, seen++) {
+        POINTERS_EQUAL(prev, node->Prev);
+        if (prev) {
+            toc_entry *a = static_cast<toc_entry *>(prev->Data);
+            toc_entry *b = static_cast<toc_entry *>(node->Data);
+            CHECK(a->play_order <= b->play_order);
+            // equal entries keep their order
+            if (a->play_order == b->play_order)
+                CHECK(a->position < b->position);
+        }
+    }
+    POINTERS_EQUAL(prev, list->Tail);
+    LONGS_EQUAL(count, seen);
+}
+
+TEST_GROUP(SortList)
+{};
+
+TEST(SortList, SortsEmptyAndSingleNodeLists)
+{
+    toc_entry entry = {1, 0};
+    listPtr list = new_list(&entry, 0);
+
+    SortList(list);
+    POINTERS_EQUAL(NULL, list->Head);
+    FreeList(list, NULL);
+
+    list = new_list(&entry, 1);
+    SortList(list);
+    check_sorted(list, 1);
+    FreeList(list, NULL);
+}
+
+TEST(SortList, SortsSmallLists)
+{
+    toc_entry entries[] = {{3, 0}, {1, 0}, {2, 0}, {1, 0}, {5, 0}, {0, 0}};
+    listPtr list = new_list(entries, 6);
+
+    SortList(list);
+    check_sorted(list, 6);
+    POINTERS_EQUAL(&entries[5], list->Head->Data);
+    POINTERS_EQUAL(&entries[1], list->Head->Next->Data);
+    POINTERS_EQUAL(&entries[3], list->Head->Next->Next->Data);
+    POINTERS_EQUAL(&entries[4], list->Tail->Data);
+    FreeList(list, NULL);
+}
+
+// The size of a dictionary NCX; a quadratic sort takes minutes here
+TEST(SortList, SortsHundredThousandNodesQuickly)
+{
+    const int count = 100000;
+    toc_entry *entries = new toc_entry[count];
+    unsigned int seed = 1;
+    clock_t start = clock();
+
+    // shuffled play orders with a few duplicates
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        entries[i].play_order = (seed >> 8) % (count - count / 10);
+    }
+
+    listPtr list = new_list(entries, count);
+    SortList(list);
+    check_sorted(list, count);
+
+    // reversed and already sorted input
+    for (int i = 0; i < count; i++)
+        entries[i].play_order = count - i;
+    FreeList(list, NULL);
+    list = new_list(entries, count);
+    SortList(list);
+    check_sorted(list, count);
+    SortList(list);
+    check_sorted(list, count);
+    FreeList(list, NULL);
+
+    CHECK((clock() - start) / CLOCKS_PER_SEC < 5);
+    delete[] entries;
+}
@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <epub.h>
+#include <epublib.h>
+#include "zipwriter.h"
+
+// Reads the deflated XHTML chapters of a book built in memory through
+// the libzip streaming reader (_ocf_stream_index) and in a single shot
+// from the raw bytes (_ocf_decompress), checks that both give the same
+// bytes and prints the best time of each over all the chapters.
+
+void usage(int code) {
+  fprintf(stderr, "Usage: ocf_inflate [options]\n");
+  fprintf(stderr, "   -h\t Help message\n");
+  fprintf(stderr, "   -n <chapters>\t chapters of the built book (500)\n");
+  fprintf(stderr, "   -s <bytes>\t size of each chapter (32768)\n");
+  fprintf(stderr, "   -r <runs>\t reads of all chapters timed with each "
+          "path (5)\n");
+
+  exit(code);
+}
+
+// Builds a book in z with chapters deflated XHTML chapters of about size
+// bytes each, named OPS/text/ch<n>.xhtml
+void build_book(struct buf *z, int chapters, int size) {
+  struct buf dir = { NULL, 0, 0 }, doc = { NULL, 0, 0 };
+  char name[64];
+  int count = 0, i, p;
+
+  putf(&doc, "application/epub+zip");
+  zip_entry(z, &dir, &count, "mimetype", &doc);
+
+  putf(&doc, "<?xml version=\"1.0\"?>\n"
+       "<container version=\"1.0\" "
+       "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\">"
+       "<rootfiles><rootfile full-path=\"OPS/content.opf\" "
+       "media-type=\"application/oebps-package+xml\"/></rootfiles>"
+       "</container>\n");
+  zip_entry(z, &dir, &count, "META-INF/container.xml", &doc);
+
+  putf(&doc, "<?xml version=\"1.0\"?>\n"
+       "<package xmlns=\"http://www.idpf.org/2007/opf\" version=\"2.0\" "
+       "unique-identifier=\"uid\">\n <metadata "
+       "xmlns:dc=\"http://purl.org/dc/elements/1.1/\">\n"
+       "  <dc:identifier id=\"uid\">0-000</dc:identifier>\n"
+       "  <dc:title>Chapters</dc:title>\n </metadata>\n <manifest>\n");
+  for (i = 0; i < chapters; i++)
+    putf(&doc, "  <item id=\"c%d\" href=\"text/ch%d.xhtml\" "
+         "media-type=\"application/xhtml+xml\"/>\n", i, i);
+  putf(&doc, " </manifest>\n <spine>\n");
+  for (i = 0; i < chapters; i++)
+    putf(&doc, "  <itemref idref=\"c%d\"/>\n", i);
+  putf(&doc, " </spine>\n</package>\n");
+  zip_entry(z, &dir, &count, "OPS/content.opf", &doc);
+
+  for (i = 0; i < chapters; i++) {
+    putf(&doc, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+         "<html xmlns=\"http://www.w3.org/1999/xhtml\"><head>"
+         "<title>Chapter %d</title>"
+         "<link rel=\"stylesheet\" href=\"../style.css\"/></head>\n"
+         "<body><h1 id=\"ch%d\">Chapter %d</h1>\n", i, i, i);
+    for (p = 0; doc.len < (size_t)size; p++)
+      putf(&doc, "<p class=\"%s\" id=\"p%d-%d\">Paragraph %d of chapter %d, "
+           "with <em>some %d</em> words and a "
+           "<a href=\"ch%d.xhtml#p%d\">link</a>.</p>\n",
+           p % 3 ? "text" : "first", i, p, p, i, (p * 7919 + i) % 100003,
+           (i + 1) % chapters, p);
+    putf(&doc, "</body></html>\n");
+    snprintf(name, sizeof(name), "OPS/text/ch%d.xhtml", i);
+    zip_deflated_entry(z, &dir, &count, name, &doc);
+  }
+
+  zip_end(z, &dir, count);
+
+  free(dir.data);
+  free(doc.data);
+}
+
+// Reads the entries first to first + chapters through read and returns
+// the time it took, or -1 if one fails. Frees what is read unless data
+// is given, where the entries are kept instead.
+double time_reads(struct ocf *ocf, zip_int64_t first, int chapters,
+                  int (*read)(struct ocf *, zip_int64_t, char **),
+                  char **data, int *sizes) {
+  struct timespec start, end;
+  char *fileStr;
+  int i, size;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < chapters; i++) {
+    if ((size = read(ocf, first + i, &fileStr)) == -1)
+      return -1;
+    if (data) {
+      data[i] = fileStr;
+      sizes[i] = size;
+    } else {
+      free(fileStr);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv) {
+  struct buf z = { NULL, 0, 0 };
+  struct epub *epub;
+  struct ocf *ocf;
+  char **stream, **direct;
+  int *streamSizes, *directSizes;
+  int chapters = 500, size = 32768, runs = 5, ret = 0;
+  double tstream = -1, tdirect = -1, t;
+  zip_int64_t first;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (! strcmp(argv[i], "-h")) {
+      usage(0);
+    } else if (! strcmp(argv[i], "-n") || ! strcmp(argv[i], "-s") ||
+               ! strcmp(argv[i], "-r")) {
+      if (i + 1 >= argc)
+        usage(2);
+      if (argv[i][1] == 'n')
+        chapters = atoi(argv[++i]);
+      else if (argv[i][1] == 's')
+        size = atoi(argv[++i]);
+      else
+        runs = atoi(argv[++i]);
+    } else {
+      usage(2);
+    }
+  }
+  if (chapters <= 0 || size <= 0)
+    usage(2);
+
+  build_book(&z, chapters, size);
+  if (! (epub = epub_open_memory(z.data, z.len, 0, 0))) {
+    fprintf(stderr, "Can't open the book\n");
+    return 1;
+  }
+  ocf = epub->ocf;
+  if (! _ocf_map_directory(ocf) ||
+      (first = zip_name_locate(ocf->arch, "OPS/text/ch0.xhtml", 0)) == -1) {
+    fprintf(stderr, "Can't find the chapters in memory\n");
+    return 1;
+  }
+
+  stream = malloc(chapters * sizeof(char *));
+  direct = malloc(chapters * sizeof(char *));
+  streamSizes = malloc(chapters * sizeof(int));
+  directSizes = malloc(chapters * sizeof(int));
+  if (! stream || ! direct || ! streamSizes || ! directSizes) {
+    fprintf(stderr, "Out of memory\n");
+    return 2;
+  }
+
+  if (time_reads(ocf, first, chapters, _ocf_stream_index,
+                 stream, streamSizes) < 0 ||
+      time_reads(ocf, first, chapters, _ocf_decompress,
+                 direct, directSizes) < 0) {
+    fprintf(stderr, "Can't read the chapters\n");
+    return 1;
+  }
+  for (i = 0; i < chapters; i++) {
+    if (streamSizes[i] != directSizes[i] ||
+        memcmp(stream[i], direct[i], streamSizes[i] + 1)) {
+      fprintf(stderr, "Chapter %d differs\n", i);
+      ret = 1;
+    }
+    free(stream[i]);
+    free(direct[i]);
+  }
+
+  for (i = 0; i < runs; i++) {
+    t = time_reads(ocf, first, chapters, _ocf_stream_index, NULL, NULL);
+    if (tstream < 0 || t < tstream)
+      tstream = t;
+    t = time_reads(ocf, first, chapters, _ocf_decompress, NULL, NULL);
+    if (tdirect < 0 || t < tdirect)
+      tdirect = t;
+  }
+
+  if (runs > 0) {
+    printf("%d deflated chapters of %d bytes, best of %d reads\n",
+           chapters, size, runs);
+    printf("   libzip stream\t %.4fs\n", tstream);
+    printf("   single shot\t %.4fs", tdirect);
+    if (tstream > 0 && tdirect > 0)
+      printf(" (%.2fx)", tstream / tdirect);
+    printf("\n");
+  }
+
+  free(stream);
+  free(direct);
+  free(streamSizes);
+  free(directSizes);
+  epub_close(epub);
+  epub_cleanup();
+  free(z.data);
+
+  return ret;
+}
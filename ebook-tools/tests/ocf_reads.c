@@ -0,0 +1,191 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+#include <epub.h>
+#include "zipwriter.h"
+
+// Reads the entries of a book built in memory through the public API,
+// as views and in byte ranges, and checks what comes back against what
+// was written, including entries whose headers don't match their data.
+
+#define BROKEN_EXTRA 1048576 // bytes a broken entry claims beyond its data
+#define SPAN 1048576 // bytes between the inflater checkpoints of range.c
+#define DEFLATED_SIZE (3 * SPAN + SPAN / 2) // of OPS/media.xhtml
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                   \
+    if (! (cond)) {                             \
+      fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+      fprintf(stderr, __VA_ARGS__);             \
+      fprintf(stderr, "\n");                    \
+      failures++;                               \
+    }                                           \
+  } while (0)
+
+// Fills b with len bytes of XHTML paragraphs
+void fill_text(struct buf *b, size_t len) {
+  size_t i;
+
+  for (i = 0; b->len < len; i++)
+    putf(b, "<p id=\"p%lu\">Paragraph %lu of the chapter.</p>\n",
+         (unsigned long)i, (unsigned long)i * 7919 % 100003);
+  b->len = len;
+}
+
+// Builds a book in z with a stored entry OPS/good.xhtml holding text, a
+// stored entry OPS/broken.xhtml whose headers claim BROKEN_EXTRA more
+// bytes than it holds and a deflated entry OPS/media.xhtml holding
+// DEFLATED_SIZE bytes of text
+void build_book(struct buf *z, struct buf *text) {
+  struct buf dir = { NULL, 0, 0 }, doc = { NULL, 0, 0 };
+  int count = 0;
+
+  putf(&doc, "application/epub+zip");
+  zip_entry(z, &dir, &count, "mimetype", &doc);
+
+  putf(&doc, "<?xml version=\"1.0\"?>\n"
+       "<container version=\"1.0\" "
+       "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\">"
+       "<rootfiles><rootfile full-path=\"OPS/content.opf\" "
+       "media-type=\"application/oebps-package+xml\"/></rootfiles>"
+       "</container>\n");
+  zip_entry(z, &dir, &count, "META-INF/container.xml", &doc);
+
+  putf(&doc, "<?xml version=\"1.0\"?>\n"
+       "<package xmlns=\"http://www.idpf.org/2007/opf\" version=\"2.0\" "
+       "unique-identifier=\"uid\">\n <metadata "
+       "xmlns:dc=\"http://purl.org/dc/elements/1.1/\">\n"
+       "  <dc:identifier id=\"uid\">0-000</dc:identifier>\n"
+       "  <dc:title>Reads</dc:title>\n </metadata>\n <manifest>\n"
+       "  <item id=\"good\" href=\"good.xhtml\" "
+       "media-type=\"application/xhtml+xml\"/>\n"
+       "  <item id=\"broken\" href=\"broken.xhtml\" "
+       "media-type=\"application/xhtml+xml\"/>\n"
+       "  <item id=\"media\" href=\"media.xhtml\" "
+       "media-type=\"application/xhtml+xml\"/>\n"
+       " </manifest>\n <spine>\n"
+       "  <itemref idref=\"good\"/>\n  <itemref idref=\"broken\"/>\n"
+       " </spine>\n</package>\n");
+  zip_entry(z, &dir, &count, "OPS/content.opf", &doc);
+
+  put(&doc, text->data, text->len);
+  zip_entry(z, &dir, &count, "OPS/good.xhtml", &doc);
+
+  zip_raw_entry(z, &dir, &count, "OPS/broken.xhtml", 0, text->data,
+                text->len, text->len + BROKEN_EXTRA,
+                crc32(0, (const Bytef *)text->data, text->len));
+
+  fill_text(&doc, DEFLATED_SIZE);
+  zip_deflated_entry(z, &dir, &count, "OPS/media.xhtml", &doc);
+
+  zip_end(z, &dir, count);
+
+  free(dir.data);
+  free(doc.data);
+}
+
+// Views of stored entries are borrowed from the archive, but only as far
+// as the entry's data goes
+void check_views(struct epub *epub, struct buf *text) {
+  struct epub_view view;
+  int size;
+
+  size = epub_get_data_view(epub, "good.xhtml", &view);
+  CHECK(size == (int)text->len, "good.xhtml view has %d bytes", size);
+  if (size == (int)text->len)
+    CHECK(! memcmp(view.data, text->data, size), "good.xhtml view differs");
+  epub_free_view(&view);
+
+  // libzip either refuses the entry or stops at the end of its data
+  size = epub_get_data_view(epub, "broken.xhtml", &view);
+  CHECK(size <= (int)text->len, "broken.xhtml view has %d bytes", size);
+  if (size > 0 && size <= (int)text->len)
+    CHECK(! memcmp(view.data, text->data, size), "broken.xhtml view differs");
+  epub_free_view(&view);
+}
+
+// Reads len bytes at offset of the entry name and compares them with
+// the same bytes of data, the whole entry of size bytes
+void check_range(struct epub *epub, const char *name, const char *data,
+                 size_t size, size_t offset, int len) {
+  int expected = offset >= size ? 0 :
+    (size - offset < (size_t)len ? (int)(size - offset) : len);
+  char *buf = malloc(len);
+  int ret;
+
+  if (! buf) {
+    fprintf(stderr, "Out of memory\n");
+    exit(2);
+  }
+
+  ret = epub_get_data_range(epub, name, offset, len, buf);
+  CHECK(ret == expected, "%s at %lu: read %d bytes of %d", name,
+        (unsigned long)offset, ret, expected);
+  if (ret == expected && ret > 0)
+    CHECK(! memcmp(buf, data + offset, ret), "%s at %lu differs", name,
+          (unsigned long)offset);
+
+  free(buf);
+}
+
+// Ranges of deflated entries inflate from the closest checkpoint, which
+// must give the bytes of the whole entry whichever order they come in
+void check_ranges(struct epub *epub, struct buf *text) {
+  char *data = NULL, buf[100];
+  int size, ret;
+
+  check_range(epub, "good.xhtml", text->data, text->len, 0, 100);
+  check_range(epub, "good.xhtml", text->data, text->len, 5000, 20000);
+  check_range(epub, "good.xhtml", text->data, text->len, text->len - 10, 100);
+
+  // the claimed bytes past the data aren't there to be read
+  ret = epub_get_data_range(epub, "broken.xhtml", text->len + 10, 100, buf);
+  CHECK(ret <= 0, "broken.xhtml past its data: read %d bytes", ret);
+
+  size = epub_get_data(epub, "media.xhtml", &data);
+  CHECK(size == DEFLATED_SIZE, "media.xhtml has %d bytes", size);
+  if (size != DEFLATED_SIZE) {
+    free(data);
+    return;
+  }
+
+  // before the first checkpoint, across one, past some, then backwards
+  check_range(epub, "media.xhtml", data, size, 1000, 50000);
+  check_range(epub, "media.xhtml", data, size, SPAN - 3000, 10000);
+  check_range(epub, "media.xhtml", data, size, 3 * SPAN + 12345, 40000);
+  check_range(epub, "media.xhtml", data, size, SPAN + 500, 10000);
+  check_range(epub, "media.xhtml", data, size, 10, 100);
+  check_range(epub, "media.xhtml", data, size, 2 * SPAN, SPAN + 7);
+  check_range(epub, "media.xhtml", data, size, size - 50, 100);
+  check_range(epub, "media.xhtml", data, size, size + 1, 100);
+
+  free(data);
+}
+
+int main(void) {
+  struct buf z = { NULL, 0, 0 }, text = { NULL, 0, 0 };
+  struct epub *epub;
+
+  fill_text(&text, 100000);
+  build_book(&z, &text);
+
+  if (! (epub = epub_open_memory(z.data, z.len, 0, 0))) {
+    fprintf(stderr, "Can't open the book\n");
+    return 1;
+  }
+
+  check_views(epub, &text);
+  check_ranges(epub, &text);
+
+  epub_close(epub);
+  epub_cleanup();
+  free(z.data);
+  free(text.data);
+
+  if (failures)
+    fprintf(stderr, "%d checks failed\n", failures);
+
+  return failures ? 1 : 0;
+}
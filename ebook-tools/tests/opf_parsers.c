@@ -0,0 +1,277 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <epub.h>
+#include "zipwriter.h"
+
+// Opens a book with the text reader and with SAX2 callbacks
+// (EPUB_OPEN_SAX), checks that both see the same book through the public
+// API and prints the best open time of each. Without a file a book with
+// a manifest of the given size is built in memory.
+
+#define NAMESPACES \
+  "xmlns:dc=\"http://purl.org/dc/elements/1.1/\" " \
+  "xmlns:opf=\"http://www.idpf.org/2007/opf\""
+
+void usage(int code) {
+  fprintf(stderr, "Usage: opf_parsers [options] [filename]\n");
+  fprintf(stderr, "   -h\t Help message\n");
+  fprintf(stderr, "   -n <items>\t manifest items of the built book (1000)\n");
+  fprintf(stderr, "   -r <runs>\t opens timed with each parser (3)\n");
+
+  exit(code);
+}
+
+// Builds a book with items manifest items in z. Its toc has a nested
+// nav map, a page list and a nav list, and the strings use entities
+// and labels in several languages, so both parsers have all of it to
+// decode alike.
+void build_book(struct buf *z, int items) {
+  struct buf dir = { NULL, 0, 0 }, doc = { NULL, 0, 0 };
+  int count = 0, i;
+
+  putf(&doc, "application/epub+zip");
+  zip_entry(z, &dir, &count, "mimetype", &doc);
+
+  putf(&doc, "<?xml version=\"1.0\"?>\n"
+       "<container version=\"1.0\" "
+       "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\">"
+       "<rootfiles><rootfile full-path=\"OPS/content.opf\" "
+       "media-type=\"application/oebps-package+xml\"/></rootfiles>"
+       "</container>\n");
+  zip_entry(z, &dir, &count, "META-INF/container.xml", &doc);
+
+  putf(&doc, "<?xml version=\"1.0\"?>\n"
+       "<package xmlns=\"http://www.idpf.org/2007/opf\" version=\"2.0\" "
+       "unique-identifier=\"uid\">\n <metadata " NAMESPACES ">\n"
+       "  <dc:identifier id=\"uid\" opf:scheme=\"ISBN\">0-000</dc:identifier>\n"
+       "  <dc:title>Fish &amp; Chips, caf&#233;</dc:title>\n"
+       "  <dc:creator opf:role=\"aut\" opf:file-as=\"Doe, J\">J Doe"
+       "</dc:creator>\n"
+       "  <dc:subject>a</dc:subject><dc:subject>b &lt; c</dc:subject>\n"
+       "  <dc:date opf:event=\"publication\">2001</dc:date>\n"
+       "  <dc:language>en</dc:language>\n"
+       "  <meta name=\"cover\" content=\"c0\"/>\n"
+       " </metadata>\n <manifest>\n"
+       "  <item id=\"ncx\" href=\"toc.ncx\" "
+       "media-type=\"application/x-dtbncx+xml\"/>\n");
+  for (i = 0; i < items; i++)
+    putf(&doc, "  <item id=\"c%d\" href=\"text/ch%d.xhtml\" "
+         "media-type=\"application/xhtml+xml\"%s/>\n", i, i,
+         i % 5 ? "" : " fallback=\"c0\"");
+  putf(&doc, " </manifest>\n <spine toc=\"ncx\">\n");
+  for (i = 0; i < items; i++)
+    putf(&doc, "  <itemref idref=\"c%d\"%s/>\n", i,
+         i % 7 ? "" : " linear=\"no\"");
+  putf(&doc, " </spine>\n <guide>\n"
+       "  <reference type=\"toc\" title=\"Contents\" href=\"text/ch0.xhtml\"/>\n"
+       "  <reference type=\"text\" title=\"Start &amp; go\" "
+       "href=\"text/ch1.xhtml#a\"/>\n </guide>\n</package>\n");
+  zip_entry(z, &dir, &count, "OPS/content.opf", &doc);
+
+  putf(&doc, "<?xml version=\"1.0\"?>\n"
+       "<ncx xmlns=\"http://www.daisy.org/z3986/2005/ncx/\" "
+       "version=\"2005-1\" xml:lang=\"en\">\n"
+       " <docTitle><text>Fish &amp; Chips</text></docTitle>\n <navMap>\n");
+  for (i = 0; i < items; i++) {
+    if (i % 10 == 0 && i)
+      putf(&doc, "  </navPoint>\n");
+    putf(&doc, "  <navPoint id=\"p%d\" class=\"%s\" playOrder=\"%d\">"
+         "<navLabel xml:lang=\"fr\"><text>Partie %d</text></navLabel>"
+         "<navLabel><text>Part %d &#38; more</text></navLabel>"
+         "<content src=\"text/ch%d.xhtml\"/>%s\n",
+         i, i % 10 ? "section" : "chapter", i + 1, i, i, i,
+         i % 10 ? "</navPoint>" : "");
+  }
+  if (items)
+    putf(&doc, "  </navPoint>\n");
+  putf(&doc, " </navMap>\n <pageList>\n"
+       "  <navLabel><text>Pages</text></navLabel>\n");
+  for (i = 0; i < items; i += 2)
+    putf(&doc, "  <pageTarget id=\"pg%d\" type=\"normal\" value=\"%d\" "
+         "playOrder=\"%d\"><navLabel><text>%d</text></navLabel>"
+         "<content src=\"text/ch%d.xhtml#pg%d\"/></pageTarget>\n",
+         i, i + 1, i + 1, i + 1, i, i);
+  putf(&doc, " </pageList>\n <navList class=\"figures\">\n"
+       "  <navLabel><text>Figures</text></navLabel>\n");
+  for (i = 0; i < items; i += 3)
+    putf(&doc, "  <navTarget id=\"f%d\" playOrder=\"%d\">"
+         "<navLabel><text>Figure %d</text></navLabel>"
+         "<content src=\"text/ch%d.xhtml#f\"/></navTarget>\n",
+         i, i + 1, i, i);
+  putf(&doc, " </navList>\n</ncx>\n");
+  zip_entry(z, &dir, &count, "OPS/toc.ncx", &doc);
+
+  putf(&doc, "<html xmlns=\"http://www.w3.org/1999/xhtml\"><body/></html>\n");
+  zip_entry(z, &dir, &count, "OPS/text/ch0.xhtml", &doc);
+
+  zip_end(z, &dir, count);
+
+  free(dir.data);
+  free(doc.data);
+}
+
+struct epub *open_book(const char *filename, struct buf *z, int flags) {
+  if (filename)
+    return epub_open_ex(filename, flags, 0);
+
+  return epub_open_memory(z->data, z->len, flags, 0);
+}
+
+// Writes what the book holds as seen through the public API to b
+void dump_book(struct epub *epub, struct buf *b) {
+  struct epub_spine_item item;
+  struct titerator *tit;
+  unsigned char **md;
+  char *link, *label;
+  int type, i, size;
+
+  for (type = EPUB_ID; type <= EPUB_META; type++) {
+    if (! (md = epub_get_metadata(epub, type, &size)))
+      continue;
+    for (i = 0; i < size; i++) {
+      putf(b, "metadata %d: %s\n", type, md[i] ? (char *)md[i] : "(null)");
+      free(md[i]);
+    }
+    free(md);
+  }
+
+  size = epub_spine_count(epub);
+  putf(b, "spine %d\n", size);
+  for (i = 0; i < size && epub_spine_get(epub, i, &item) == 0; i++)
+    putf(b, "spine %d: %s %s %s %d\n", i, item.idref,
+         item.href ? item.href : "(null)",
+         item.media_type ? item.media_type : "(null)", item.linear);
+
+  for (type = TITERATOR_NAVMAP; type <= TITERATOR_PAGES; type++) {
+    if (! (tit = epub_get_titerator(epub, type, 0))) {
+      putf(b, "toc %d none\n", type);
+      continue;
+    }
+    do {
+      if (! epub_tit_curr_valid(tit))
+        continue;
+      link = epub_tit_get_curr_link(tit);
+      label = epub_tit_get_curr_label(tit);
+      putf(b, "toc %d: %d %s %s\n", type, epub_tit_get_curr_depth(tit),
+           link ? link : "(null)", label ? label : "(null)");
+      free(link);
+      free(label);
+    } while (epub_tit_next(tit));
+    epub_free_titerator(tit);
+  }
+}
+
+// Returns the best time of runs opens of the book with the given flags,
+// its toc included since both parsers read it on first use
+double time_open(const char *filename, struct buf *z, int flags, int runs) {
+  struct timespec start, end;
+  struct titerator *tit;
+  struct epub *epub;
+  double best = -1, t;
+  int i;
+
+  for (i = 0; i < runs; i++) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (! (epub = open_book(filename, z, flags)))
+      return -1;
+    if ((tit = epub_get_titerator(epub, TITERATOR_NAVMAP, 0)))
+      epub_free_titerator(tit);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    epub_close(epub);
+
+    t = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (best < 0 || t < best)
+      best = t;
+  }
+
+  return best;
+}
+
+// Prints the first line that differs between a and b
+void print_difference(struct buf *a, struct buf *b) {
+  size_t i, line = 0;
+  int la, lb;
+
+  for (i = 0; i < a->len && i < b->len && a->data[i] == b->data[i]; i++)
+    if (a->data[i] == '\n')
+      line = i + 1;
+
+  for (la = 0; line + la < a->len && a->data[line + la] != '\n'; la++)
+    ;
+  for (lb = 0; line + lb < b->len && b->data[line + lb] != '\n'; lb++)
+    ;
+  fprintf(stderr, "reader: %.*s\nsax:    %.*s\n", la, a->data + line,
+          lb, b->data + line);
+}
+
+int main(int argc, char **argv) {
+  struct buf z = { NULL, 0, 0 }, reader = { NULL, 0, 0 }, sax = { NULL, 0, 0 };
+  struct epub *epub;
+  char *filename = NULL;
+  int items = 1000, runs = 3, ret = 0;
+  double treader, tsax;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (! strcmp(argv[i], "-h")) {
+      usage(0);
+    } else if (! strcmp(argv[i], "-n") || ! strcmp(argv[i], "-r")) {
+      if (i + 1 >= argc)
+        usage(2);
+      if (argv[i][1] == 'n')
+        items = atoi(argv[++i]);
+      else
+        runs = atoi(argv[++i]);
+    } else if (argv[i][0] == '-' || filename) {
+      usage(2);
+    } else {
+      filename = argv[i];
+    }
+  }
+
+  if (! filename)
+    build_book(&z, items);
+
+  if (! (epub = open_book(filename, &z, 0))) {
+    fprintf(stderr, "Can't open the book with the text reader\n");
+    return 1;
+  }
+  dump_book(epub, &reader);
+  epub_close(epub);
+
+  if (! (epub = open_book(filename, &z, EPUB_OPEN_SAX))) {
+    fprintf(stderr, "Can't open the book with SAX2 callbacks\n");
+    return 1;
+  }
+  dump_book(epub, &sax);
+  epub_close(epub);
+
+  if (reader.len != sax.len || memcmp(reader.data, sax.data, reader.len)) {
+    fprintf(stderr, "The parsers don't agree\n");
+    print_difference(&reader, &sax);
+    ret = 1;
+  }
+
+  if (runs > 0) {
+    treader = time_open(filename, &z, 0, runs);
+    tsax = time_open(filename, &z, EPUB_OPEN_SAX, runs);
+    if (filename)
+      printf("%s, best of %d opens\n", filename, runs);
+    else
+      printf("%d manifest items, best of %d opens\n", items, runs);
+    printf("   text reader\t %.4fs\n", treader);
+    printf("   SAX2\t\t %.4fs", tsax);
+    if (treader > 0 && tsax > 0)
+      printf(" (%.2fx)", treader / tsax);
+    printf("\n");
+  }
+
+  free(z.data);
+  free(reader.data);
+  free(sax.data);
+  epub_cleanup();
+
+  return ret;
+}
@@ -0,0 +1,66 @@
+#include <CppUTest/TestHarness.h>
+
+#include <cstdio>
+#include <strpool.h>
+
+TEST_GROUP(StrPool)
+{};
+
+TEST(StrPool, NullIsOffsetZero)
+{
+    struct strpool *pool = strpool_new();
+
+    POINTERS_EQUAL(NULL, strpool_strdup(pool, NULL));
+    POINTERS_EQUAL(NULL, strpool_get(pool, 0));
+    LONGS_EQUAL(0, strpool_offset(pool, NULL));
+    strpool_free(pool);
+}
+
+TEST(StrPool, OffsetsFindTheStrings)
+{
+    struct strpool *pool = strpool_new();
+    const char *text = "some text";
+
+    char *copy = strpool_strdup(pool, text);
+    STRCMP_EQUAL(text, copy);
+    CHECK(copy != text);
+
+    uint32_t offset = strpool_offset(pool, copy);
+    CHECK(offset != 0);
+    POINTERS_EQUAL(copy, strpool_get(pool, offset));
+    LONGS_EQUAL(0, strpool_offset(pool, text));
+    strpool_free(pool);
+}
+
+TEST(StrPool, StringsStayPutWhileGrowing)
+{
+    struct strpool *pool = strpool_new();
+    const int count = 20000;
+    char **copies = new char *[count];
+    uint32_t *offsets = new uint32_t[count];
+    char name[32];
+    int i;
+
+    // some strings too big for the chunk in use in between
+    for (i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "item%d", i);
+        copies[i] = strpool_strdup(pool, name);
+        offsets[i] = strpool_offset(pool, copies[i]);
+        if (i % 5000 == 0)
+            CHECK(strpool_alloc(pool, 100000) != NULL);
+    }
+    for (i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "item%d", i);
+        STRCMP_EQUAL(name, copies[i]);
+        POINTERS_EQUAL(copies[i], strpool_get(pool, offsets[i]));
+    }
+
+    delete[] offsets;
+    delete[] copies;
+    strpool_free(pool);
+}
+
+TEST(StrPool, FreesNull)
+{
+    strpool_free(NULL);
+}
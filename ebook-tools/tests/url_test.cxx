@@ -28,4 +28,31 @@ TEST(UrlDecode, WorksForSpace)
 
     url_decode(spaces, sizeof(spaces));
     STRCMP_EQUAL(" string with encoded spaces ", spaces);
-}
\ No newline at end of file
+}
+
+TEST(UrlDecode, WorksForAnyCode)
+{
+    char codes[] = "caf%C3%A9%2fmenu%3Fa%3db%23top";
+
+    url_decode(codes, sizeof(codes));
+    STRCMP_EQUAL("caf\xC3\xA9/menu?a=b#top", codes);
+}
+
+TEST(UrlDecode, TerminatesTheDecodedString)
+{
+    char spaces[] = "a%20b";
+
+    url_decode(spaces, strlen(spaces));
+    STRCMP_EQUAL("a b", spaces);
+}
+
+TEST(UrlDecode, KeepsIncompleteCodes)
+{
+    char bad[] = "100%zz%4";
+    char end[] = "end%";
+
+    url_decode(bad, sizeof(bad));
+    STRCMP_EQUAL("100%zz%4", bad);
+    url_decode(end, sizeof(end));
+    STRCMP_EQUAL("end%", end);
+}
@@ -0,0 +1,139 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+#include "zipwriter.h"
+
+void reserve(struct buf *b, size_t len) {
+  if (b->len + len <= b->alloc)
+    return;
+
+  b->alloc = (b->len + len) * 2;
+  if (! (b->data = realloc(b->data, b->alloc))) {
+    fprintf(stderr, "Out of memory\n");
+    exit(2);
+  }
+}
+
+void put(struct buf *b, const void *data, size_t len) {
+  reserve(b, len);
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+}
+
+void putf(struct buf *b, const char *format, ...) {
+  va_list ap;
+  int len;
+
+  va_start(ap, format);
+  len = vsnprintf(NULL, 0, format, ap);
+  va_end(ap);
+
+  reserve(b, len + 1);
+  va_start(ap, format);
+  vsnprintf(b->data + b->len, len + 1, format, ap);
+  va_end(ap);
+  b->len += len;
+}
+
+void put16(struct buf *b, unsigned int value) {
+  unsigned char bytes[2] = { value & 0xff, (value >> 8) & 0xff };
+
+  put(b, bytes, 2);
+}
+
+void put32(struct buf *b, unsigned long value) {
+  put16(b, value & 0xffff);
+  put16(b, (value >> 16) & 0xffff);
+}
+
+void zip_entry(struct buf *z, struct buf *dir, int *count, const char *name,
+               struct buf *data) {
+  zip_raw_entry(z, dir, count, name, 0, data->data, data->len, data->len,
+                crc32(0, (const Bytef *)data->data, data->len));
+  data->len = 0;
+}
+
+void zip_deflated_entry(struct buf *z, struct buf *dir, int *count,
+                        const char *name, struct buf *data) {
+  struct buf raw = { NULL, 0, 0 };
+  z_stream strm;
+
+  memset(&strm, 0, sizeof(z_stream));
+  if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    fprintf(stderr, "Can't deflate %s\n", name);
+    exit(2);
+  }
+
+  reserve(&raw, deflateBound(&strm, data->len));
+  strm.next_in = (Bytef *)data->data;
+  strm.avail_in = data->len;
+  strm.next_out = (Bytef *)raw.data;
+  strm.avail_out = raw.alloc;
+  if (deflate(&strm, Z_FINISH) != Z_STREAM_END) {
+    fprintf(stderr, "Can't deflate %s\n", name);
+    exit(2);
+  }
+  raw.len = strm.total_out;
+  deflateEnd(&strm);
+
+  zip_raw_entry(z, dir, count, name, Z_DEFLATED, raw.data, raw.len,
+                data->len, crc32(0, (const Bytef *)data->data, data->len));
+  free(raw.data);
+  data->len = 0;
+}
+
+void zip_raw_entry(struct buf *z, struct buf *dir, int *count,
+                   const char *name, int method, const char *raw,
+                   size_t compLen, size_t len, unsigned long crc) {
+  size_t offset = z->len, nameLen = strlen(name);
+
+  put32(z, 0x04034b50);
+  put16(z, 20); // version needed
+  put16(z, 0); // flags
+  put16(z, method);
+  put32(z, 0); // time and date
+  put32(z, crc);
+  put32(z, compLen);
+  put32(z, len);
+  put16(z, nameLen);
+  put16(z, 0); // extra
+  put(z, name, nameLen);
+  put(z, raw, compLen);
+
+  put32(dir, 0x02014b50);
+  put16(dir, 20); // version made by
+  put16(dir, 20);
+  put16(dir, 0);
+  put16(dir, method);
+  put32(dir, 0);
+  put32(dir, crc);
+  put32(dir, compLen);
+  put32(dir, len);
+  put16(dir, nameLen);
+  put16(dir, 0); // extra
+  put16(dir, 0); // comment
+  put16(dir, 0); // disk
+  put16(dir, 0); // internal attributes
+  put32(dir, 0); // external attributes
+  put32(dir, offset);
+  put(dir, name, nameLen);
+
+  (*count)++;
+}
+
+void zip_end(struct buf *z, struct buf *dir, int count) {
+  size_t dirOffset = z->len;
+
+  put(z, dir->data, dir->len);
+  put32(z, 0x06054b50);
+  put16(z, 0); // disk
+  put16(z, 0); // disk of the directory
+  put16(z, count);
+  put16(z, count);
+  put32(z, dir->len);
+  put32(z, dirOffset);
+  put16(z, 0); // comment
+}
@@ -0,0 +1,42 @@
+#ifndef ZIPWRITER_H
+#define ZIPWRITER_H 1
+
+#include <stddef.h>
+
+// Writes zip archives in memory for the test drivers, so they can build
+// books with exactly the entries (and the inconsistencies) they need.
+
+struct buf {
+  char *data;
+  size_t len;
+  size_t alloc;
+};
+
+// Makes room for len more bytes in b
+void reserve(struct buf *b, size_t len);
+void put(struct buf *b, const void *data, size_t len);
+#ifdef __GNUC__
+void putf(struct buf *b, const char *format, ...)
+  __attribute__((format(printf, 2, 3)));
+#else
+void putf(struct buf *b, const char *format, ...);
+#endif
+void put16(struct buf *b, unsigned int value);
+void put32(struct buf *b, unsigned long value);
+
+// Adds a stored entry with the contents of data to the zip in z and its
+// record to the central directory in dir. Empties data.
+void zip_entry(struct buf *z, struct buf *dir, int *count, const char *name,
+               struct buf *data);
+// Like zip_entry but the entry is deflated
+void zip_deflated_entry(struct buf *z, struct buf *dir, int *count,
+                        const char *name, struct buf *data);
+// Like zip_entry but writes compLen bytes of raw data as they are, with
+// the given method and the given uncompressed size and crc in the headers
+void zip_raw_entry(struct buf *z, struct buf *dir, int *count,
+                   const char *name, int method, const char *raw,
+                   size_t compLen, size_t len, unsigned long crc);
+// Appends the central directory in dir and its end record to z
+void zip_end(struct buf *z, struct buf *dir, int count);
+
+#endif // ZIPWRITER_H